@@ -0,0 +1,39 @@
+# Writes every shader file in SHADER_DIR to OUTPUT as constexpr byte arrays, for EmbeddedShaders (src/embeddedShaders.h).
+# An include naming a file that isn't there fails the build instead of the launch.
+# cmake -DSHADER_DIR=<shaders> -DOUTPUT=<file.cpp> -P EmbedShaders.cmake
+
+file(GLOB files RELATIVE "${SHADER_DIR}" "${SHADER_DIR}/*.glsl" "${SHADER_DIR}/*.vert" "${SHADER_DIR}/*.frag" "${SHADER_DIR}/*.geom")
+list(SORT files)
+
+set(arrays "")
+set(table "")
+set(index 0)
+foreach(name IN LISTS files)
+    file(READ "${SHADER_DIR}/${name}" text)
+    string(REGEX MATCHALL "#[ \t]*include[ \t]+\"[^\"]+\"" includes "${text}")
+    foreach(include IN LISTS includes)
+        string(REGEX REPLACE ".*\"([^\"]+)\"" "\\1" included "${include}")
+        if(NOT EXISTS "${SHADER_DIR}/${included}")
+            message(FATAL_ERROR "${name} includes ${included}, which isn't in ${SHADER_DIR}")
+        endif()
+    endforeach()
+
+    # Bytes rather than string literals, MSVC caps the length of those
+    file(READ "${SHADER_DIR}/${name}" hex HEX)
+    string(LENGTH "${hex}" hexLength)
+    math(EXPR length "${hexLength} / 2")
+    string(REGEX REPLACE "([0-9a-f][0-9a-f])" "0x\\1," bytes "${hex}")
+    string(APPEND arrays "    constexpr unsigned char shader${index}[] = { ${bytes}0x00 };\n")
+    string(APPEND table "    { \"shaders/${name}\", shader${index}, ${length} },\n")
+    math(EXPR index "${index} + 1")
+endforeach()
+
+file(WRITE "${OUTPUT}.tmp"
+    "// Generated by cmake/EmbedShaders.cmake from ${SHADER_DIR}, do not edit\n"
+    "#include \"embeddedShaders.h\"\n\n"
+    "namespace {\n${arrays}}\n\n"
+    "const EmbeddedShader EmbeddedShaders::files[] = {\n${table}};\n"
+    "const size_t EmbeddedShaders::fileCount = ${index};\n")
+# Only touch the output when it changed, so unchanged shaders don't rebuild it
+execute_process(COMMAND ${CMAKE_COMMAND} -E copy_if_different "${OUTPUT}.tmp" "${OUTPUT}")
+file(REMOVE "${OUTPUT}.tmp")
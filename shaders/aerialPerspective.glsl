@@ -0,0 +1,22 @@
+// Aerial perspective froxels, the light scattered between the camera and a distance along the view ray
+// through each point of the screen with the phase functions applied. The slices go from the nearest to
+// the furthest point of the atmosphere the camera can see, closer together near the camera.
+#include "frameData.glsl"
+
+uniform sampler3D aerialPerspective;
+
+float aerialPerspectiveSlice(float distanceToCamera) {
+    return sqrt(clamp((distanceToCamera - aerialPerspectiveNear) / (aerialPerspectiveFar - aerialPerspectiveNear), 0.0, 1.0));
+}
+
+// Inverse of aerialPerspectiveSlice
+float aerialPerspectiveDistance(float slice01) {
+    return aerialPerspectiveNear + slice01 * slice01 * (aerialPerspectiveFar - aerialPerspectiveNear);
+}
+
+// uv is the position on the screen, the edge froxels sit on the edges of the screen
+vec3 aerialPerspectiveAt(vec2 uv, float distanceToCamera) {
+    vec3 size = vec3(textureSize(aerialPerspective, 0));
+    vec3 x01 = vec3(clamp(uv, 0.0, 1.0), aerialPerspectiveSlice(distanceToCamera));
+    return textureLod(aerialPerspective, (0.5 + x01 * (size - 1.0)) / size, 0.0).rgb;
+}
@@ -0,0 +1,17 @@
+#version 330 core
+
+// Fills one slice of the aerial perspective froxels, one froxel per fragment
+uniform int slice;
+uniform float lutSize; // froxels along each axis
+
+#include "scattering.glsl"
+#include "screenRay.glsl"
+#include "aerialPerspective.glsl"
+
+out vec4 FragColor;
+
+void main() {
+    vec2 screenUv = (gl_FragCoord.xy - 0.5) / (lutSize - 1.0);
+    float sliceDistance = aerialPerspectiveDistance(float(slice) / (lutSize - 1.0));
+    FragColor = vec4(scatteredLight(screenRay(screenUv), sliceDistance), 1.0);
+}
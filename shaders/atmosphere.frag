@@ -1,23 +1,44 @@
 #version 330 core
 
-uniform vec3 lightPos;
-uniform float gMie;
-uniform float gMie2;
-uniform float exposure;
+// Atmosphere over the rendered scene, integrated per pixel up to the depth drawn there
+// or read from the sky-view LUT and the aerial perspective froxels
+uniform sampler2D sceneColor;
+// Reduced resolution pass: write just the atmosphere and the distance it went to, the upsample adds the scene
+uniform bool writeDistance;
+// Only redraw this frame's quarter of the pixels, the others keep their history where it fits (needs writeDistance)
+uniform bool temporal;
 
+#include "scattering.glsl"
+#include "screenRay.glsl"
+#include "skyView.glsl"
+#include "aerialPerspective.glsl"
+#include "temporal.glsl"
 
-in vec3 v3Direction;
-in vec4 rayleighColor;
-in vec4 mieColor;
+in vec2 uv;
 
 out vec4 FragColor;
 
 void main() {
-    float fCos = dot(normalize(lightPos), normalize(v3Direction));
-    float fCos2 = fCos * fCos;
-    float fMiePhase = 1.5 * ((1.0 - gMie2) / (2.0 + gMie2)) * (1.0 + fCos2) / pow(1.0 + gMie2 - 2.0*gMie*fCos, 1.5);
-    
-    float fRayleighPhase = 0.75 * (1.0 + fCos2);
-    vec4 combinedColor = rayleighColor * fRayleighPhase + fMiePhase * mieColor;
-    FragColor = 1.0 -  exp(combinedColor * -exposure);
-}
\ No newline at end of file
+    vec3 v3Ray = screenRay(uv);
+    // Stop at the surface where the planet was drawn
+    float surfaceDistance = sceneDistance(uv);
+    bool sky = surfaceDistance >= skyDistance;
+
+    vec3 reused;
+    if (temporal && !temporalRefresh(ivec2(gl_FragCoord.xy)) &&
+        fetchHistory(cameraPos + v3Ray * surfaceDistance, !sky, surfaceDistance, reused)) {
+        FragColor = vec4(reused, surfaceDistance);
+        return;
+    }
+
+    vec3 combinedColor;
+    if (!sky && useAerialPerspective) {
+        combinedColor = aerialPerspectiveAt(uv, surfaceDistance);
+    } else if (sky && useSkyViewLut) {
+        combinedColor = skyViewAt(v3Ray);
+    } else {
+        combinedColor = scatteredLight(v3Ray, sky ? 1e30 : surfaceDistance);
+    }
+    vec3 atmosphere = 1.0 - exp(combinedColor * -exposure);
+    FragColor = writeDistance ? vec4(atmosphere, surfaceDistance) : vec4(texture(sceneColor, uv).rgb + atmosphere, 1.0);
+}
@@ -1,15 +1,9 @@
 #version 330 core
 
-layout (location = 0) in vec3 aPos;
-uniform mat4 model, projection, view;
-
-#include "scattering.glsl"
+// One triangle covering the screen, drawn without a vertex buffer
+out vec2 uv;
 
 void main(void) {
-    vec3 v3Pos = (model * vec4(aPos, 1.0)).xyz;
-    
-    
-    setScattering(v3Pos); // found in common.vert
-
-    gl_Position = projection * view * vec4(v3Pos, 1.0);
-}
\ No newline at end of file
+    uv = vec2((gl_VertexID << 1) & 2, gl_VertexID & 2);
+    gl_Position = vec4(uv * 2.0 - 1.0, 0.0, 1.0);
+}
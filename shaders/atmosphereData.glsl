@@ -0,0 +1,19 @@
+// Atmosphere of the planet, shared by every program. Keep in sync with AtmosphereUniforms.
+layout(std140) uniform AtmosphereData {
+    vec3 invWavelength4;
+    float atmosphereRadius;
+    float atmosphereRadius2;
+    float planetRadius;
+    float planetRadius2;
+    float kRayleighSunBrightness;
+    float kMieSunBrightness;
+    float scale;
+    float scaleDepth;
+    float densityFalloff;
+    float gMie;
+    float gMie2;
+    float exposure;
+    int nSamples;
+    int opticalDepthMode; // 0 = ray march, 1 = transmittance LUT, 2 = Chapman function
+    bool multipleScattering;
+};
@@ -0,0 +1,34 @@
+#version 330 core
+
+// Brings the reduced resolution atmosphere up to the screen and adds the scene.
+// Of the four low resolution pixels around a pixel the ones that went about as far count the most,
+// so the sky doesn't bleed over the edge of the planet and the planet doesn't darken the sky.
+#include "frameData.glsl"
+uniform sampler2D sceneColor;
+uniform sampler2D atmosphereColor; // rgb = atmosphere, a = distance it was integrated to
+
+#include "screenRay.glsl"
+
+in vec2 uv;
+
+out vec4 FragColor;
+
+void main() {
+    float surfaceDistance = sceneDistance(uv);
+    ivec2 size = textureSize(atmosphereColor, 0);
+    vec2 texel = uv * vec2(size) - 0.5;
+    ivec2 base = ivec2(floor(texel));
+    vec2 f = texel - vec2(base);
+
+    vec3 atmosphere = vec3(0.0);
+    float total = 0.0;
+    for (int i = 0; i < 4; i++) {
+        ivec2 offset = ivec2(i & 1, i >> 1);
+        vec4 lowRes = texelFetch(atmosphereColor, clamp(base + offset, ivec2(0), size - 1), 0);
+        vec2 bilinear = mix(1.0 - f, f, vec2(offset));
+        float weight = bilinear.x * bilinear.y / (abs(lowRes.a - surfaceDistance) / surfaceDistance + 0.02);
+        atmosphere += lowRes.rgb * weight;
+        total += weight;
+    }
+    FragColor = vec4(texture(sceneColor, uv).rgb + atmosphere / max(total, 1e-6), 1.0);
+}
@@ -0,0 +1,12 @@
+#version 330 core
+
+// Clouds over the scene, drawn with glBlendFunc(GL_ONE, GL_SRC_ALPHA) so the scene is dimmed by their transmittance
+uniform sampler2D clouds;
+
+in vec2 uv;
+
+out vec4 FragColor;
+
+void main() {
+    FragColor = texture(clouds, uv);
+}
@@ -0,0 +1,70 @@
+#version 330 core
+
+// Bakes the tileable cloud noise volume a slice at a time. r = Perlin-Worley base shape,
+// gba = Worley fBm at 2, 4 and 8 times its frequency, for eroding the edges of the shape.
+uniform int slice;
+uniform float volumeSize;
+
+#include "noise.glsl"
+
+out vec4 FragColor;
+
+const float baseCells = 4.0; // lattice cells across the volume at the base frequency
+
+// Perlin noise whose lattice wraps every period cells, so the volume tiles
+float tiledPerlin(vec3 pos, float period) {
+    vec3 i = floor(pos);
+    vec3 pf = fract(pos);
+    vec3 f = fade(pf);
+
+    float n000 = dot(randomGradient(mod(i + vec3(0,0,0), period)), pf - vec3(0,0,0));
+    float n100 = dot(randomGradient(mod(i + vec3(1,0,0), period)), pf - vec3(1,0,0));
+    float n010 = dot(randomGradient(mod(i + vec3(0,1,0), period)), pf - vec3(0,1,0));
+    float n110 = dot(randomGradient(mod(i + vec3(1,1,0), period)), pf - vec3(1,1,0));
+    float n001 = dot(randomGradient(mod(i + vec3(0,0,1), period)), pf - vec3(0,0,1));
+    float n101 = dot(randomGradient(mod(i + vec3(1,0,1), period)), pf - vec3(1,0,1));
+    float n011 = dot(randomGradient(mod(i + vec3(0,1,1), period)), pf - vec3(0,1,1));
+    float n111 = dot(randomGradient(mod(i + vec3(1,1,1), period)), pf - vec3(1,1,1));
+
+    float x00 = mix(n000, n100, f.x);
+    float x10 = mix(n010, n110, f.x);
+    float x01 = mix(n001, n101, f.x);
+    float x11 = mix(n011, n111, f.x);
+    return mix(mix(x00, x10, f.y), mix(x01, x11, f.y), f.z);
+}
+
+// One feature point per cell, 1 at a point and 0 a cell away from all of them
+float tiledWorley(vec3 pos, float period) {
+    vec3 cell = floor(pos);
+    vec3 f = fract(pos);
+    float closest = 1.0;
+    for (int z = -1; z <= 1; z++) {
+        for (int y = -1; y <= 1; y++) {
+            for (int x = -1; x <= 1; x++) {
+                vec3 offset = vec3(x, y, z);
+                uvec3 h = pcg3d(uvec3(ivec3(mod(cell + offset, period))) + 0x9e3779b9u);
+                vec3 featurePoint = offset + vec3(h) * (1.0 / 4294967295.0);
+                closest = min(closest, length(featurePoint - f));
+            }
+        }
+    }
+    return 1.0 - closest;
+}
+
+float worleyFbm(vec3 p, float cells) {
+    return tiledWorley(p * cells, cells) * 0.625 + tiledWorley(p * cells * 2.0, cells * 2.0) * 0.25 +
+        tiledWorley(p * cells * 4.0, cells * 4.0) * 0.125;
+}
+
+void main() {
+    vec3 p = vec3(gl_FragCoord.xy, float(slice) + 0.5) / volumeSize;
+
+    float perlin = tiledPerlin(p * baseCells, baseCells) + 0.5 * tiledPerlin(p * baseCells * 2.0, baseCells * 2.0) +
+        0.25 * tiledPerlin(p * baseCells * 4.0, baseCells * 4.0);
+    perlin = clamp(perlin / 1.75 + 0.5, 0.0, 1.0);
+    // Perlin noise remapped into the Worley cells gives billows instead of blobs
+    float worley = worleyFbm(p, baseCells);
+    float base = clamp((perlin - (worley - 1.0)) / (2.0 - worley), 0.0, 1.0);
+
+    FragColor = vec4(base, worleyFbm(p, baseCells * 2.0), worleyFbm(p, baseCells * 4.0), worleyFbm(p, baseCells * 8.0));
+}
@@ -0,0 +1,130 @@
+#version 330 core
+
+// Cloud layer in a shell of the atmosphere, ray marched through the baked noise volume. Drawn at reduced
+// resolution into a TemporalHistory: each frame a checkerboard half of the pixels is marched and blended with
+// its history, the other half is reprojected. rgb = light scattered towards the camera, a = transmittance.
+uniform sampler3D cloudNoise;
+uniform float cloudBottom;   // radii of the shell
+uniform float cloudTop;
+uniform float cloudCoverage; // [0, 1]
+uniform float cloudDensity;  // extinction per world unit of the densest cloud
+uniform float cloudScale;    // noise volume tiles per world unit
+uniform vec3 cloudOffset;    // wind
+uniform int cloudSteps;
+uniform int cloudLightSteps;
+
+#include "scattering.glsl"
+#include "screenRay.glsl"
+#include "temporal.glsl"
+
+in vec2 uv;
+
+out vec4 FragColor;
+
+const float cloudDetailScale = 4.0; // the detail noise repeats this much faster than the shape
+const float cloudAmbient = 0.3;     // skylight, as a fraction of the sunlight
+const float cloudHistoryWeight = 0.5;
+const float cloudPi = 3.14159265;
+
+// Distances along the ray to where it enters and leaves a sphere around the planet center, x > y if it misses
+vec2 sphereHits(vec3 origin, vec3 dir, float radius) {
+    float b = dot(origin, dir);
+    float d = b * b - dot(origin, origin) + radius * radius;
+    if (d < 0.0) return vec2(1.0, -1.0);
+    float s = sqrt(d);
+    return vec2(-b - s, -b + s);
+}
+
+// Part of the view ray inside the shell, up to the first time it leaves it and no further than maxDistance
+bool cloudSegment(vec3 ray, float maxDistance, out float start, out float end) {
+    vec2 top = sphereHits(cameraPos, ray, cloudTop);
+    start = max(top.x, 0.0);
+    end = top.y;
+    vec2 bottom = sphereHits(cameraPos, ray, cloudBottom);
+    if (bottom.x <= bottom.y) {
+        if (bottom.x > 0.0) end = min(end, bottom.x);
+        else start = max(start, bottom.y); // from below the clouds
+    }
+    end = min(end, maxDistance);
+    return end > start;
+}
+
+float remap(float value, float low, float high) {
+    return (value - low) / (high - low);
+}
+
+float cloudDensityAt(vec3 p, bool detailed) {
+    float height01 = (length(p) - cloudBottom) / (cloudTop - cloudBottom);
+    float profile = smoothstep(0.0, 0.15, height01) * smoothstep(1.0, 0.5, height01);
+    vec3 noisePos = (p + cloudOffset) * cloudScale;
+    float shape = remap(textureLod(cloudNoise, noisePos, 0.0).r * profile, 1.0 - max(cloudCoverage, 0.001), 1.0);
+    if (shape <= 0.0) return 0.0;
+    if (detailed) {
+        float detail = dot(textureLod(cloudNoise, noisePos * cloudDetailScale, 0.0).gba, vec3(0.625, 0.25, 0.125));
+        shape = remap(shape, detail * 0.35, 1.0);
+    }
+    return max(shape, 0.0) * cloudDensity;
+}
+
+float henyeyGreenstein(float cosTheta, float g) {
+    float g2 = g * g;
+    return (1.0 - g2) / (4.0 * cloudPi * pow(1.0 + g2 - 2.0 * g * cosTheta, 1.5));
+}
+
+void main() {
+    vec3 ray = screenRay(uv);
+    float start, end;
+    if (!cloudSegment(ray, sceneDistance(uv), start, end)) {
+        FragColor = vec4(0.0, 0.0, 0.0, 1.0);
+        return;
+    }
+
+    // Inside the shell the entry point is the camera itself, a point a little way in moves more like the clouds do
+    float reprojectDistance = start > 0.0 ? start : 0.5 * min(end, cloudTop - cloudBottom);
+    vec4 previous;
+    vec3 previousPos;
+    bool hasHistory = reprojectHistory(cameraPos + ray * reprojectDistance, false, previous, previousPos);
+    if (hasHistory && !checkerboardRefresh(ivec2(gl_FragCoord.xy))) {
+        FragColor = previous;
+        return;
+    }
+
+    vec3 sunDir = normalize(lightPos);
+    float cosTheta = dot(ray, sunDir);
+    // Scaled so isotropic scattering is 1, a forward lobe for silver linings and a weaker back lobe
+    float phase = 4.0 * cloudPi * mix(henyeyGreenstein(cosTheta, 0.6), henyeyGreenstein(cosTheta, -0.3), 0.3);
+    // Sunlight through the atmosphere above the clouds, once per ray
+    vec3 entry = cameraPos + ray * start;
+    vec3 sunlight = lightColor * exp(-opticalDepthToTop(entry, sunDir) * invWavelength4);
+    vec3 ambient = sunlight * cloudAmbient * smoothstep(-0.2, 0.3, dot(normalize(entry), sunDir));
+
+    float stepSize = (end - start) / float(cloudSteps);
+    float lightStepSize = 0.5 * (cloudTop - cloudBottom) / float(cloudLightSteps);
+    // Interleaved gradient noise, the offset moves every frame so the history blend averages out the banding
+    float jitter = fract(52.9829189 * fract(dot(gl_FragCoord.xy, vec2(0.06711056, 0.00583715))) + 0.618034 * float(temporalFrame));
+
+    vec3 light = vec3(0.0);
+    float transmittance = 1.0;
+    for (int i = 0; i < cloudSteps; i++) {
+        vec3 p = cameraPos + ray * (start + (float(i) + jitter) * stepSize);
+        float density = cloudDensityAt(p, true);
+        if (density <= 0.0) continue;
+
+        float lightDepth = 0.0;
+        for (int j = 0; j < cloudLightSteps; j++) {
+            lightDepth += cloudDensityAt(p + sunDir * lightStepSize * (float(j) + 0.5), false) * lightStepSize;
+        }
+        // The slower second falloff stands in for light scattered more than once
+        float sunTransmittance = max(exp(-lightDepth), 0.7 * exp(-0.25 * lightDepth));
+        vec3 scattered = sunlight * phase * sunTransmittance + ambient;
+
+        // Integrated over the step, so a dense step can't add more light than it blocks
+        float stepTransmittance = exp(-density * stepSize);
+        light += transmittance * scattered * (1.0 - stepTransmittance);
+        transmittance *= stepTransmittance;
+        if (transmittance < 0.01) break;
+    }
+
+    vec4 clouds = vec4(light, transmittance);
+    FragColor = hasHistory ? mix(clouds, previous, cloudHistoryWeight) : clouds;
+}
@@ -0,0 +1,54 @@
+
+#include "cubeMap.glsl"
+
+// Crater field built on the CPU (see CraterNoiseFilter): a quadtree per cube face, with all
+// levels flattened into one cell array. Each cell lists copies of the craters overlapping it.
+uniform samplerBuffer craterCells;        // xyz = crater center on the unit sphere, w = radius
+uniform isamplerBuffer craterCellOffsets; // first entry of each cell in craterCells, one extra at the end
+uniform int craterMinLevel;
+uniform int craterMaxLevel;               // below craterMinLevel when there are no craters
+uniform int craterLayer;                  // the noise layer the crater field belongs to
+
+const float craterRimExtent = 1.5;
+const float craterDepthRatio = 0.25;
+
+// Bowl with a raised rim, d is the distance from the center in crater radii
+float craterProfile(float d) {
+    const float floorHeight = -0.6;
+    const float rimWidth = craterRimExtent - 1.0;
+    const float rimSteepness = 0.4;
+
+    float cavity = d * d - 1.0;
+    float rimX = min(d - 1.0 - rimWidth, 0.0);
+    float rim = rimSteepness * rimX * rimX;
+    return min(max(cavity, floorHeight), rim);
+}
+
+float craterHeight(vec3 pointOnUnitSphere) {
+    if (craterMaxLevel < craterMinLevel) return 0.0;
+
+    // cell on the finest level, the coarser levels are found by shifting
+    vec2 uv;
+    int face = cubeFaceCoords(pointOnUnitSphere, uv);
+    int finest = 1 << craterMaxLevel;
+    ivec2 cell = clamp(ivec2(floor((uv * 0.5 + 0.5) * float(finest))), ivec2(0), ivec2(finest - 1));
+
+    float height = 0.0;
+    for (int level = craterMinLevel; level <= craterMaxLevel; level++) {
+        int resolution = 1 << level;
+        ivec2 levelCell = cell >> (craterMaxLevel - level);
+        int index = 6 * ((1 << (2 * level)) - 1) / 3 + (face * resolution + levelCell.y) * resolution + levelCell.x;
+
+        int first = texelFetch(craterCellOffsets, index).r;
+        int last = texelFetch(craterCellOffsets, index + 1).r;
+        for (int i = first; i < last; i++) {
+            vec4 crater = texelFetch(craterCells, i);
+            vec3 offset = pointOnUnitSphere - crater.xyz;
+            float reach = crater.w * craterRimExtent;
+            if (dot(offset, offset) < reach * reach) {
+                height += craterProfile(length(offset) / crater.w) * crater.w * craterDepthRatio;
+            }
+        }
+    }
+    return height;
+}
@@ -0,0 +1,34 @@
+
+// Same face order and orientation as GL cube maps and CubeMap::FaceCoords,
+// for data stored per cube face in buffers rather than cube textures
+int cubeFaceCoords(vec3 dir, out vec2 uv) {
+    vec3 a = abs(dir);
+    if (a.x >= a.y && a.x >= a.z) {
+        uv = (dir.x > 0.0 ? vec2(-dir.z, -dir.y) : vec2(dir.z, -dir.y)) / a.x;
+        return dir.x > 0.0 ? 0 : 1;
+    }
+    if (a.y >= a.z) {
+        uv = (dir.y > 0.0 ? vec2(dir.x, dir.z) : vec2(dir.x, -dir.z)) / a.y;
+        return dir.y > 0.0 ? 2 : 3;
+    }
+    uv = (dir.z > 0.0 ? vec2(dir.x, -dir.y) : vec2(-dir.x, -dir.y)) / a.z;
+    return dir.z > 0.0 ? 4 : 5;
+}
+
+// Inverse of cubeFaceCoords, CubeMap::Direction normalized. For baking into cube textures.
+vec3 cubeFaceDirection(int face, vec2 uv) {
+    if (face == 0) return normalize(vec3(1.0, -uv.y, -uv.x));
+    if (face == 1) return normalize(vec3(-1.0, -uv.y, uv.x));
+    if (face == 2) return normalize(vec3(uv.x, 1.0, uv.y));
+    if (face == 3) return normalize(vec3(uv.x, -1.0, -uv.y));
+    if (face == 4) return normalize(vec3(uv.x, -uv.y, 1.0));
+    return normalize(vec3(-uv.x, -uv.y, -1.0));
+}
+
+// Flat index of the grid cell containing dir, for a gridSize x gridSize grid on each face
+int cubeGridCell(vec3 dir, int gridSize) {
+    vec2 uv;
+    int face = cubeFaceCoords(dir, uv);
+    ivec2 cell = clamp(ivec2(floor((uv * 0.5 + 0.5) * float(gridSize))), ivec2(0), ivec2(gridSize - 1));
+    return (face * gridSize + cell.y) * gridSize + cell.x;
+}
@@ -0,0 +1,12 @@
+// Camera and light of the current frame, shared by every program. Keep in sync with FrameUniforms.
+layout(std140) uniform FrameData {
+    vec3 cameraPos;
+    float cameraHeight;
+    vec3 lightPos;
+    float cameraHeight2;
+    vec3 lightColor;
+    float aerialPerspectiveNear;
+    float aerialPerspectiveFar;
+    bool useSkyViewLut;
+    bool useAerialPerspective; // surfaces read the aerial perspective froxels instead of integrating their own
+};
@@ -0,0 +1,15 @@
+#version 330 core
+
+// Bakes the humidity noise of planet.frag into one face of a cube map, it only depends on the point on the sphere
+uniform int face;
+uniform float faceSize;
+
+#include "noise.glsl"
+#include "cubeMap.glsl"
+
+out vec4 FragColor;
+
+void main() {
+    vec3 pointOnUnitSphere = cubeFaceDirection(face, gl_FragCoord.xy / faceSize * 2.0 - 1.0);
+    FragColor = vec4(GenerateNoise(pointOnUnitSphere, 2.1, 0.4, 4.0, 2.5, 0.5), 0.0, 0.0, 1.0);
+}
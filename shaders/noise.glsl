@@ -5,6 +5,15 @@ vec3 fade(vec3 t) {
     return t * t * t * (t * (t * 6.0 - 15.0) + 10.0);
 }
 
+// Integer hash (pcg3d), the same bits on every GPU
+uvec3 pcg3d(uvec3 v) {
+    v = v * 1664525u + 1013904223u;
+    v.x += v.y * v.z; v.y += v.z * v.x; v.z += v.x * v.y;
+    v ^= v >> 16u;
+    v.x += v.y * v.z; v.y += v.z * v.x; v.z += v.x * v.y;
+    return v;
+}
+
 // Hash function to generate pseudo-random float in [-1, 1]
 float rand(vec3 p) {
     return fract(sin(dot(p ,vec3(127.1, 311.7, 74.7)) + seed) * 43758.5453) * 2.0 - 1.0;
@@ -44,15 +53,25 @@ float perlinNoise(vec3 pos) {
     return mix(y0, y1, f.z);
 }
 
-float GenerateNoise(vec3 pointOnUnitSphere, float frequency, float persistence, int octaves, float roughness, float scaling)
+// octaves can be fractional (octave LOD), the last octave is faded in by the fractional part.
+// No more than maxOctaves are summed, a constant there gives the loop a bound the compiler can unroll.
+float GenerateNoise(vec3 pointOnUnitSphere, float frequency, float persistence, float octaves, float roughness, float scaling, int maxOctaves)
 {
     float noise = 0.0;
-    for (int i = 0; i < octaves; i++)
+    int octaveCount = int(ceil(octaves));
+    for (int i = 0; i < maxOctaves; i++)
     {
+        if (i >= octaveCount) break;
+        float fade = min(octaves - float(i), 1.0);
         vec3 p = pointOnUnitSphere * frequency;
-        noise += perlinNoise(p) * scaling;
+        noise += perlinNoise(p) * scaling * fade;
         frequency *= roughness;
         scaling *= persistence;
     }
     return noise;
-}
\ No newline at end of file
+}
+
+float GenerateNoise(vec3 pointOnUnitSphere, float frequency, float persistence, float octaves, float roughness, float scaling)
+{
+    return GenerateNoise(pointOnUnitSphere, frequency, persistence, octaves, roughness, scaling, int(ceil(octaves)));
+}
@@ -0,0 +1,19 @@
+// Terrain noise layers, keep in sync with NoiseLayersUniforms and maxNoiseLayers in noiseLayer.h
+struct NoiseLayer {
+    bool enabled;
+    float strength;
+    float baseRoughness;
+    float roughness;
+    float persistence;
+    int octaves;
+    float visibleOctaves; // octaves after LOD, may be fractional
+    float minValue;
+    vec3 center;
+    int type; // 0 = perlin, 1 = worley, 2 = craters, 3 = plates
+    int worleyOutput;
+};
+
+layout(std140) uniform NoiseLayers {
+    int layerCount;
+    NoiseLayer noiseLayers[128];
+};
@@ -7,21 +7,21 @@ in float gElevation;
 in vec3 gUnitSpherePos;
 
 
-uniform vec3 lightPos;  
-uniform vec3 lightColor;
-uniform vec3 cameraPos;
 uniform float maxElevation;
-uniform float exposure;
 
 //atmosphere stuff
 in vec3 gDirection;
 in vec4 gRayleighColor;
 in vec4 gMieColor;
-uniform float gMie;
-uniform float gMie2;
+in vec4 gMultiScatteringColor;
+uniform vec2 viewportSize;
+uniform samplerCube humidityMap; // GenerateNoise(p, 2.1, 0.4, 4.0, 2.5, 0.5), baked per seed
 
+#include "frameData.glsl"
+#include "atmosphereData.glsl"
 #include "biomeDefs.glsl"
 #include "noise.glsl"
+#include "aerialPerspective.glsl"
 
 void main() {
 
@@ -47,15 +47,20 @@ void main() {
     float latitude = abs(gUnitSpherePos.y);
     float temp = 1.0 - latitude; // 1=equator, 0=pole
     
-    float humidity = (GenerateNoise(gUnitSpherePos, 2.1, 0.4, 4, 2.5, 0.5) * 0.5 + 0.5) - abs(gUnitSpherePos.y)/2.4; 
+    float humidity = (texture(humidityMap, gUnitSpherePos).r * 0.5 + 0.5) - abs(gUnitSpherePos.y)/2.4;
     
     vec3 vBiomeColor = calculateFinalBiomeColor(temp, humidity, gElevation / maxElevation, gUnitSpherePos); // in biomeDefs.glsl
-    float fCos = dot(normalize(lightPos), normalize(gDirection));
+    vec4 atmospheric;
+    if (useAerialPerspective) {
+        atmospheric = vec4(aerialPerspectiveAt(gl_FragCoord.xy / viewportSize, length(gPosition - cameraPos)), 0.0);
+    } else {
+        float fCos = dot(normalize(lightPos), normalize(gDirection));
 
-    float fMiePhase = 1.5 * ((1.0 - gMie2) / (2.0 + gMie2)) * (1.0 + fCos*fCos) / pow(1.0 + gMie2 - 2.0*gMie*fCos, 1.5);
-    
-    float fRayleighPhase = 0.75 * (1.0 + fCos*fCos);
-    vec4 atmospheric = gRayleighColor * fRayleighPhase + fMiePhase * gMieColor;
+        float fMiePhase = 1.5 * ((1.0 - gMie2) / (2.0 + gMie2)) * (1.0 + fCos*fCos) / pow(1.0 + gMie2 - 2.0*gMie*fCos, 1.5);
+        
+        float fRayleighPhase = 0.75 * (1.0 + fCos*fCos);
+        atmospheric = gRayleighColor * fRayleighPhase + fMiePhase * gMieColor + gMultiScatteringColor;
+    }
     vec4 realColor = vec4(vBiomeColor * phong, 1);
     vec4 combinedColor = realColor * atmospheric * 0.6 + atmospheric * 0.1 + realColor * 0.4; // Add a bit of atmosphere to the final color
     FragColor = 1.0 -  exp(combinedColor * -exposure); // HDR (make bright a little less birght, dark a bit less dark)
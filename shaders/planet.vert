@@ -1,42 +1,63 @@
 #version 330 core
 
-struct NoiseLayer {  
-    bool enabled;
-    float strength;
-    float baseRoughness;
-    float roughness;
-    float persistence;
-    int octaves;    
-    float minValue;
-    vec3 center;
-};
+#include "noiseLayers.glsl"
 
 
 layout (location = 0) in vec3 aPos;
 uniform mat4 model, view, projection;
-uniform int layerCount;
-uniform NoiseLayer noiseLayers[8];
 
 out vec3 vPosition;
 out float vElevation;
 out vec3 vUnitSpherePos;
+
+// Elevation baked (and eroded) on the CPU, used instead of the noise layers when set
+uniform bool useBakedHeightmap;
+uniform samplerCube heightmap;
 #include "noise.glsl"
-#include "scattering.glsl"
+#include "worley.glsl"
+#include "craters.glsl"
+#include "plates.glsl"
+#include "scatteringVertex.glsl"
+
+// Elevation added by one layer. Permutations pass the type and octave count as constants, which folds
+// away the other types and bounds the octave loop.
+float EvaluateLayer(vec3 pointOnUnitSphere, int i, int type, int maxOctaves) {
+    // craters displace both ways, so they skip the clamping below
+    if (type == 2) {
+        return i == craterLayer ? craterHeight(pointOnUnitSphere) * noiseLayers[i].strength : 0.0;
+    }
+    if (type == 3) {
+        return i == plateLayer ? plateHeight(pointOnUnitSphere) * noiseLayers[i].strength : 0.0;
+    }
+
+    float frequency = noiseLayers[i].baseRoughness;
+    float layerValue;
+    if (type == 1) {
+        layerValue = GenerateWorleyNoise(pointOnUnitSphere, frequency, noiseLayers[i].persistence, noiseLayers[i].visibleOctaves, noiseLayers[i].roughness, 1.0, noiseLayers[i].worleyOutput, maxOctaves);
+    } else {
+        layerValue = GenerateNoise(pointOnUnitSphere, frequency, noiseLayers[i].persistence, noiseLayers[i].visibleOctaves, noiseLayers[i].roughness, 1.0, maxOctaves);
+    }
+
+    layerValue = layerValue * noiseLayers[i].strength - noiseLayers[i].minValue;
+    return max(0.0, 0.5 + 0.5 * layerValue);
+}
+
+// Permutations define NOISE_LAYERS as one NOISE_LAYER(index, type, octaves) per enabled layer (see NoiseLayerDefines),
+// the generic program loops over the layers in the uniform block
+#ifdef NOISE_LAYERS
+#define NOISE_LAYER(i, type, octaves) elevation += EvaluateLayer(pointOnUnitSphere, i, type, octaves);
+#endif
 
 // Evaluate layered noise on unit sphere
 float EvaluateNoise(vec3 pointOnUnitSphere) {
     float elevation = 0.0;
-
+#ifdef NOISE_LAYERS
+    NOISE_LAYERS
+#else
     for (int i = 0; i < layerCount; i++) {
-        if (!noiseLayers[i].enabled) continue;
-
-        float frequency = noiseLayers[i].baseRoughness;
-        float layerValue = GenerateNoise(pointOnUnitSphere, frequency, noiseLayers[i].persistence, noiseLayers[i].octaves, noiseLayers[i].roughness, 1.0);
-
-        layerValue = layerValue * noiseLayers[i].strength - noiseLayers[i].minValue;
-        elevation += max(0.0, 0.5 + 0.5 * layerValue);
+        if (noiseLayers[i].enabled) elevation += EvaluateLayer(pointOnUnitSphere, i, noiseLayers[i].type, noiseLayers[i].octaves);
     }
-
+#endif
     return elevation;
 }
 
@@ -66,7 +87,7 @@ vec3 ComputeNoiseNormal(vec3 unitSpherePos) {
 
 void main() {
     vec3 unitSpherePos = normalize(aPos);
-    vElevation = EvaluateNoise(unitSpherePos);
+    vElevation = useBakedHeightmap ? textureLod(heightmap, unitSpherePos, 0.0).r : EvaluateNoise(unitSpherePos);
     vec3 worldPos = (model * vec4(aPos * (1.0 + vElevation), 1.0)).xyz;
 
     setScattering(worldPos); // found in common.vert
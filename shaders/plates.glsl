@@ -0,0 +1,83 @@
+// Tectonic plates built on the CPU (see PlateNoiseFilter), keep plateHeight in sync with PlateNoiseFilter::Height.
+// The cube map holds the plate closest to each texel center, the Delaunay neighbours of the plates
+// are used to walk to the right plate and to find every plate that blends in at a point.
+uniform isamplerCube plateCells;     // r = plate
+uniform samplerBuffer plateData;     // 2 texels per plate: (site on the unit sphere, height), (Euler pole * angular speed, first neighbour)
+uniform isamplerBuffer plateNeighbours;
+uniform int plateLayer;              // the noise layer the plates belong to
+uniform float plateSoftness;
+
+const float plateRidgeHeight = 0.5;
+const int maxBlendPlates = 16;
+const int maxPlateWalk = 32;
+
+// Neighbours of a plate are plateNeighbours[x, y)
+ivec2 plateNeighbourRange(int plate) {
+    return ivec2(texelFetch(plateData, 2 * plate + 1).w, texelFetch(plateData, 2 * plate + 3).w);
+}
+
+float plateHeight(vec3 pointOnUnitSphere) {
+    vec3 p = pointOnUnitSphere;
+    int plate = textureLod(plateCells, p, 0.0).r;
+    if (plate < 0) return 0.0;
+
+    // The texel center can be in the plate next door, step to closer neighbours until there are none
+    float closest = dot(p, texelFetch(plateData, 2 * plate).xyz);
+    for (int step = 0; step < maxPlateWalk; step++) {
+        int next = plate;
+        ivec2 range = plateNeighbourRange(plate);
+        for (int i = range.x; i < range.y; i++) {
+            int other = texelFetch(plateNeighbours, i).r;
+            float d = dot(p, texelFetch(plateData, 2 * other).xyz);
+            if (d > closest) {
+                closest = d;
+                next = other;
+            }
+        }
+        if (next == plate) break;
+        plate = next;
+    }
+
+    // Grow the blended set through neighbours, every plate less than plateSoftness further away gets a weight
+    int ids[maxBlendPlates];
+    float weights[maxBlendPlates];
+    int count = 1;
+    ids[0] = plate;
+    weights[0] = 1.0;
+    float total = 1.0;
+    for (int n = 0; n < maxBlendPlates; n++) {
+        if (n >= count) break;
+        ivec2 range = plateNeighbourRange(ids[n]);
+        for (int i = range.x; i < range.y && count < maxBlendPlates; i++) {
+            int other = texelFetch(plateNeighbours, i).r;
+            float falloff = 1.0 - (closest - dot(p, texelFetch(plateData, 2 * other).xyz)) / plateSoftness;
+            if (falloff <= 0.0) continue;
+            bool seen = false;
+            for (int j = 0; j < count; j++) seen = seen || ids[j] == other;
+            if (seen) continue;
+            ids[count] = other;
+            weights[count] = falloff * falloff * falloff;
+            total += weights[count];
+            count++;
+        }
+    }
+
+    float height = 0.0;
+    for (int i = 0; i < count; i++) {
+        weights[i] /= total;
+        height += weights[i] * texelFetch(plateData, 2 * ids[i]).w;
+    }
+
+    // Ridges and rifts along each border, 4 * wi * wj peaks at 1 where two plates meet
+    for (int i = 0; i < count; i++) {
+        vec3 siteA = texelFetch(plateData, 2 * ids[i]).xyz;
+        vec3 rotationA = texelFetch(plateData, 2 * ids[i] + 1).xyz;
+        for (int j = i + 1; j < count; j++) {
+            vec3 siteB = texelFetch(plateData, 2 * ids[j]).xyz;
+            vec3 rotationB = texelFetch(plateData, 2 * ids[j] + 1).xyz;
+            float convergence = dot(cross(rotationA - rotationB, p), normalize(siteB - siteA));
+            height += 4.0 * weights[i] * weights[j] * convergence * plateRidgeHeight;
+        }
+    }
+    return max(height, 0.0);
+}
@@ -1,25 +1,18 @@
-uniform vec3 cameraPos;
-uniform vec3 lightPos;
-uniform vec3 invWavelength4;
-uniform vec3 lightColor; 
-uniform float cameraHeight;
-uniform float cameraHeight2;
-uniform float atmosphereRadius;
-uniform float atmosphereRadius2;
-uniform float planetRadius;
-uniform float planetRadius2;
-uniform float kRayleighSunBrightness;
-uniform float kMieSunBrightness;
-uniform float scale;
-uniform float scaleDepth;
-uniform float densityFalloff;
-uniform int nSamples;
-
-out vec3 v3Direction;
-out vec4 rayleighColor;
-out vec4 mieColor;
-
-float fSamples = float(nSamples);
+#include "frameData.glsl"
+#include "atmosphereData.glsl"
+uniform sampler2D transmittanceLut;
+uniform sampler2D multiScatteringLut;
+
+// Permutations define these (see ScatteringDefines), the generic program reads them from AtmosphereData
+#ifndef SCATTERING_SAMPLES
+#define SCATTERING_SAMPLES nSamples
+#endif
+#ifndef OPTICAL_DEPTH_MODE
+#define OPTICAL_DEPTH_MODE opticalDepthMode
+#endif
+#ifndef MULTIPLE_SCATTERING
+#define MULTIPLE_SCATTERING multipleScattering
+#endif
 
 const int depthSamples = 10; // Number of samples to take along the ray for optical depth calculation
 
@@ -80,13 +73,84 @@ float opticalDepth(vec3 rayOrigin, vec3 rayDir, float rayLength)
     return opticalDepth;
 }
 
-//set mie and rayleigh scattering colors
-void setScattering(vec3 v3Pos)
+// Keep in sync with TransmittanceLutCoord in atmosphereLut.cpp
+vec2 transmittanceLutCoord(float height01, float cosZenith) {
+    height01 = clamp(height01, 0.0, 1.0);
+    float ratio = planetRadius / (planetRadius + height01 * (atmosphereRadius - planetRadius));
+    float horizon = -sqrt(max(0.0, 1.0 - ratio * ratio));
+    float x = cosZenith >= horizon ?
+        0.5 + 0.5 * sqrt(min((cosZenith - horizon) / (1.0 - horizon), 1.0)) :
+        0.5 - 0.5 * sqrt(min((horizon - cosZenith) / (1.0 + horizon), 1.0));
+    vec2 size = vec2(textureSize(transmittanceLut, 0));
+    return (0.5 + vec2(x, sqrt(height01)) * (size - 1.0)) / size;
+}
+
+// Optical depth from a point to the top of the atmosphere, read from the transmittance LUT
+float lutOpticalDepth(vec3 point, vec3 dir) {
+    float radius = length(point);
+    float thickness = atmosphereRadius - planetRadius;
+    vec2 uv = transmittanceLutCoord((radius - planetRadius) / thickness, dot(point, dir) / radius);
+    return textureLod(transmittanceLut, uv, 0.0).r * thickness;
+}
+
+// Chapman function for zenith cosines from 0 up, x is the radius in scale heights.
+// Keep this and the two below in sync with atmosphereLut.cpp.
+float chapmanUpper(float x, float cosZenith) {
+    float y = sqrt(0.5 * x) * cosZenith;
+    float correction = 1.0 + (0.45 + 0.3 * cosZenith * cosZenith) / x;
+    return sqrt(2.0 * x) / (1.275 * y + sqrt(0.525625 * y * y + 1.2732395)) * correction;
+}
+
+float relativeDensity(float radius, float scaleHeight) {
+    return exp(min((planetRadius - radius) / scaleHeight, 50.0));
+}
+
+// Optical depth to infinity of an exponential atmosphere that doesn't stop at the top
+float chapmanToInfinity(float radius, float cosZenith, float scaleHeight) {
+    float x = radius / scaleHeight;
+    if (cosZenith >= 0.0) {
+        return relativeDensity(radius, scaleHeight) * scaleHeight * chapmanUpper(x, cosZenith);
+    }
+    // Below the horizon it's both ways from the lowest point of the ray minus the way back up
+    float lowest = radius * sqrt(max(0.0, 1.0 - cosZenith * cosZenith));
+    return scaleHeight * (2.0 * relativeDensity(lowest, scaleHeight) * chapmanUpper(lowest / scaleHeight, 0.0) -
+        relativeDensity(radius, scaleHeight) * chapmanUpper(x, -cosZenith));
+}
+
+// Optical depth from a point to the top of the atmosphere without any loop or texture
+float chapmanOpticalDepth(vec3 point, vec3 dir) {
+    float radius = length(point);
+    float cosZenith = dot(point, dir) / radius;
+    float scaleHeight = (atmosphereRadius - planetRadius) * scaleDepth / max(densityFalloff, 0.01);
+    // Take away what lies past the top of the atmosphere, from where the ray leaves it
+    float exitCos = sqrt(max(0.0, 1.0 - radius * radius * max(0.0, 1.0 - cosZenith * cosZenith) / atmosphereRadius2));
+    return max(chapmanToInfinity(radius, cosZenith, scaleHeight) - chapmanToInfinity(atmosphereRadius, exitCos, scaleHeight), 0.0);
+}
+
+float opticalDepthToTop(vec3 point, vec3 dir) {
+    return OPTICAL_DEPTH_MODE == 1 ? lutOpticalDepth(point, dir) : chapmanOpticalDepth(point, dir);
+}
+
+// Light scattered more than once per unit of sunlight, keep in sync with MultiScatteringLut::Sample in atmosphereLut.cpp
+vec3 multiScatteringAt(vec3 point, vec3 sunDir) {
+    float radius = length(point);
+    vec2 x01 = vec2(0.5 + 0.5 * dot(point, sunDir) / radius, (radius - planetRadius) / (atmosphereRadius - planetRadius));
+    vec2 size = vec2(textureSize(multiScatteringLut, 0));
+    return textureLod(multiScatteringLut, (0.5 + clamp(x01, 0.0, 1.0) * (size - 1.0)) / size, 0.0).rgb;
+}
+
+// Light scattered towards the camera along a view ray, up to maxDistance away (the surface seen along it, if any).
+// Rayleigh and Mie still need their phase functions, multiple scattering is isotropic.
+void integrateScattering(vec3 v3Ray, float maxDistance, out vec3 rayleigh, out vec3 mie, out vec3 multi)
 {
+    rayleigh = vec3(0.0);
+    mie = vec3(0.0);
+    multi = vec3(0.0);
+
+    // Rays that miss the atmosphere see none of it
+    float B = 2.0 * dot(cameraPos, v3Ray);
+    if (B * B - 4.0 * (cameraHeight2 - atmosphereRadius2) < 0.0) return;
 
-    vec3 v3LookDisplacement = v3Pos - cameraPos;
-    
-    vec3 v3Ray = normalize(v3LookDisplacement);
     float fFar = getFarIntersection(cameraPos, v3Ray, cameraHeight2, atmosphereRadius2);
 
     // If the ray intersects the planet, set fFar to the intersection point
@@ -94,24 +158,35 @@ void setScattering(vec3 v3Pos)
     {
         fFar =  getNearIntersection(cameraPos, v3Ray, cameraHeight2, planetRadius2);
     }
+    fFar = min(fFar, maxDistance);
     float fNear = getNearIntersection(cameraPos, v3Ray, cameraHeight2, atmosphereRadius2);
     if(fNear < 0)
     {
         fNear = 0;
     }
+    if (fFar <= fNear) return;
     vec3 v3Start = cameraPos + v3Ray * fNear;
     
     
     vec3 v3FrontColor = vec3(0.0, 0.0, 0.0);
+    vec3 v3MultiColor = vec3(0.0, 0.0, 0.0);
 
-    float stepSize = abs(fFar - fNear) / fSamples;
+    float stepSize = abs(fFar - fNear) / float(SCATTERING_SAMPLES);
     vec3 v3SampleRay = v3Ray * stepSize;
     vec3 v3SamplePoint = v3Start + v3SampleRay * 0.5;
     if(cameraHeight < atmosphereRadius)
     {
         v3SamplePoint = v3Start;
     }
-    for(int i = 0; i < nSamples; i++) {
+    // Without the ray march the depth between the start and a sample is the difference of two depths to the top of
+    // the atmosphere along the view line, taken in whichever direction points up at the sample so it misses the planet
+    float startDepthForward = 0.0;
+    float startDepthBackward = 0.0;
+    if (OPTICAL_DEPTH_MODE != 0) {
+        startDepthForward = opticalDepthToTop(v3Start, v3Ray);
+        startDepthBackward = opticalDepthToTop(v3Start, -v3Ray);
+    }
+    for(int i = 0; i < SCATTERING_SAMPLES; i++) {
         vec3 sunDir = normalize(lightPos);
         
         // prevent numerical issues by moving the sample point slightly towards the sun (in case the point is just on the surface, make sure it's slightly above the surface)
@@ -122,20 +197,45 @@ void setScattering(vec3 v3Pos)
         
         // total optical depth between sun and sample point 
         // used to calculate how much light would get scattered by the atmosphere going from sun to sample point
-        float sunRayOpticalDepth = opticalDepth(v3SamplePoint, sunDir, fSunRayLength);
+        float sunRayOpticalDepth;
         // total optical depth between camera and sample point
         // used  to calculate how much light would be scattered by the atmosphere going from sample point to camera
-        float fViewRayDepth = opticalDepth(v3SamplePoint, -v3Ray, length(v3SamplePoint - cameraPos) - fNear);
+        float fViewRayDepth;
+        if (OPTICAL_DEPTH_MODE != 0) {
+            sunRayOpticalDepth = opticalDepthToTop(v3SamplePoint, sunDir);
+            fViewRayDepth = dot(v3SamplePoint, v3Ray) >= 0.0 ?
+                startDepthForward - opticalDepthToTop(v3SamplePoint, v3Ray) :
+                opticalDepthToTop(v3SamplePoint, -v3Ray) - startDepthBackward;
+            fViewRayDepth = max(fViewRayDepth, 0.0);
+        } else {
+            sunRayOpticalDepth = opticalDepth(v3SamplePoint, sunDir, fSunRayLength);
+            fViewRayDepth = opticalDepth(v3SamplePoint, -v3Ray, length(v3SamplePoint - cameraPos) - fNear);
+        }
 
         // transmittance is the amount of light that reaches the sample point from the sun
         vec3 transmittance = exp((-sunRayOpticalDepth - fViewRayDepth) * invWavelength4);
         float localDensity = densityAtPoint(v3SamplePoint);
     
         v3FrontColor += localDensity * transmittance * stepSize * invWavelength4;
+        if (MULTIPLE_SCATTERING) {
+            v3MultiColor += localDensity * exp(-fViewRayDepth * invWavelength4) * stepSize * invWavelength4 * multiScatteringAt(v3SamplePoint, sunDir);
+        }
         v3SamplePoint += v3SampleRay;
     }
-    v3Direction = normalize(cameraPos - v3Pos);
 
-    mieColor.rgb = kMieSunBrightness * v3FrontColor * lightColor;
-    rayleighColor.rgb = kRayleighSunBrightness * v3FrontColor * lightColor * invWavelength4;
+    mie = kMieSunBrightness * v3FrontColor * lightColor;
+    rayleigh = kRayleighSunBrightness * v3FrontColor * lightColor * invWavelength4;
+    multi = (kRayleighSunBrightness * invWavelength4 + kMieSunBrightness) * v3MultiColor * lightColor;
+}
+
+// Light scattered towards the camera along a view ray, up to maxDistance away, with the phase functions applied
+vec3 scatteredLight(vec3 v3Ray, float maxDistance) {
+    vec3 rayleighColor, mieColor, multiScatteringColor;
+    integrateScattering(v3Ray, maxDistance, rayleighColor, mieColor, multiScatteringColor);
+
+    float fCos = dot(normalize(lightPos), -v3Ray);
+    float fCos2 = fCos * fCos;
+    float fMiePhase = 1.5 * ((1.0 - gMie2) / (2.0 + gMie2)) * (1.0 + fCos2) / pow(1.0 + gMie2 - 2.0*gMie*fCos, 1.5);
+    float fRayleighPhase = 0.75 * (1.0 + fCos2);
+    return rayleighColor * fRayleighPhase + fMiePhase * mieColor + multiScatteringColor;
 }
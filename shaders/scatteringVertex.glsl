@@ -0,0 +1,18 @@
+// Scattering worked out per vertex of a mesh, the fragment shader applies the phase functions
+#include "scattering.glsl"
+
+out vec3 v3Direction;
+out vec4 rayleighColor;
+out vec4 mieColor;
+out vec4 multiScatteringColor; // isotropic, no phase function
+
+//set mie and rayleigh scattering colors
+void setScattering(vec3 v3Pos)
+{
+    v3Direction = normalize(cameraPos - v3Pos);
+    vec3 rayleigh = vec3(0.0), mie = vec3(0.0), multi = vec3(0.0);
+    if (!useAerialPerspective) integrateScattering(normalize(v3Pos - cameraPos), 1e30, rayleigh, mie, multi);
+    rayleighColor = vec4(rayleigh, 0.0);
+    mieColor = vec4(mie, 0.0);
+    multiScatteringColor = vec4(multi, 0.0);
+}
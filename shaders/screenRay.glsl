@@ -0,0 +1,21 @@
+// View rays and scene distances of full-screen passes
+#include "frameData.glsl"
+
+uniform mat4 inverseViewProjection;
+uniform sampler2D sceneDepth;
+
+// Distance used where nothing was drawn, still fits a half float
+const float skyDistance = 10000.0;
+
+vec3 screenRay(vec2 uv) {
+    vec4 farPoint = inverseViewProjection * vec4(uv * 2.0 - 1.0, 1.0, 1.0);
+    return normalize(farPoint.xyz / farPoint.w - cameraPos);
+}
+
+// Distance from the camera to what was drawn at uv
+float sceneDistance(vec2 uv) {
+    float depth = texture(sceneDepth, uv).r;
+    if (depth >= 1.0) return skyDistance;
+    vec4 surface = inverseViewProjection * vec4(vec3(uv, depth) * 2.0 - 1.0, 1.0);
+    return length(surface.xyz / surface.w - cameraPos);
+}
@@ -0,0 +1,54 @@
+// Sky-view LUT, the sky seen from the camera over the angle between the view and the sun around the zenith (x,
+// the other side mirrors it) and the elevation (y), squeezed towards the horizon where the sky changes fastest.
+// Redrawn every frame the camera is inside the atmosphere.
+#include "scattering.glsl"
+
+uniform sampler2D skyViewLut;
+
+const float skyViewPi = 3.14159265;
+
+// Zenith, and towards the sun along the ground
+void skyViewFrame(out vec3 up, out vec3 forward) {
+    up = normalize(cameraPos);
+    vec3 sunDir = normalize(lightPos);
+    forward = sunDir - up * dot(sunDir, up);
+    if (dot(forward, forward) < 1e-8) forward = cross(up, abs(up.x) < 0.9 ? vec3(1.0, 0.0, 0.0) : vec3(0.0, 1.0, 0.0));
+    forward = normalize(forward);
+}
+
+// Elevation of the horizon, it dips below zero as the camera rises
+float skyViewHorizon() {
+    return -acos(clamp(planetRadius / cameraHeight, 0.0, 1.0));
+}
+
+// Both in [0, 1], the horizon is at y = 0.5
+vec2 skyViewCoord(vec3 v3Ray) {
+    vec3 up, forward;
+    skyViewFrame(up, forward);
+    float horizon = skyViewHorizon();
+    float elevation = asin(clamp(dot(v3Ray, up), -1.0, 1.0)) - horizon;
+    float y = elevation >= 0.0 ?
+        0.5 + 0.5 * sqrt(min(elevation / (0.5 * skyViewPi - horizon), 1.0)) :
+        0.5 - 0.5 * sqrt(min(-elevation / (0.5 * skyViewPi + horizon), 1.0));
+    vec3 side = v3Ray - up * dot(v3Ray, up);
+    float x = dot(side, side) > 1e-12 ? acos(clamp(dot(normalize(side), forward), -1.0, 1.0)) / skyViewPi : 0.0;
+    return vec2(x, y);
+}
+
+// Inverse of skyViewCoord
+vec3 skyViewRay(vec2 x01) {
+    vec3 up, forward;
+    skyViewFrame(up, forward);
+    float horizon = skyViewHorizon();
+    float y = 2.0 * x01.y - 1.0;
+    float elevation = horizon + (y >= 0.0 ? y * y * (0.5 * skyViewPi - horizon) : -y * y * (0.5 * skyViewPi + horizon));
+    float azimuth = x01.x * skyViewPi;
+    vec3 side = cos(azimuth) * forward + sin(azimuth) * cross(up, forward);
+    return cos(elevation) * side + sin(elevation) * up;
+}
+
+// Scattered light along a ray that sees no surface, phase functions applied
+vec3 skyViewAt(vec3 v3Ray) {
+    vec2 size = vec2(textureSize(skyViewLut, 0));
+    return textureLod(skyViewLut, (0.5 + skyViewCoord(v3Ray) * (size - 1.0)) / size, 0.0).rgb;
+}
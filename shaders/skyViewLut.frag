@@ -0,0 +1,14 @@
+#version 330 core
+
+// Fills the sky-view LUT, one texel per fragment
+uniform vec2 lutSize;
+
+#include "scattering.glsl"
+#include "skyView.glsl"
+
+out vec4 FragColor;
+
+void main() {
+    vec2 x01 = (gl_FragCoord.xy - 0.5) / (lutSize - 1.0);
+    FragColor = vec4(scatteredLight(skyViewRay(x01), 1e30), 1.0);
+}
@@ -0,0 +1,50 @@
+// Reuse of last frame's result of a full-screen pass, see TemporalHistory. Each frame one pixel of every
+// 2x2 block is redrawn in a rotating order, the others reproject into the history and keep what they find
+// there unless it belongs to something else.
+uniform sampler2D history; // rgb = last frame's result, a = its distance to the camera
+uniform bool historyValid;
+uniform int temporalFrame;
+uniform mat4 previousViewProjection;
+uniform mat4 previousModelFromModel;
+uniform vec3 previousCameraPos;
+
+// Relative change in distance past which the history counts as something else
+const float historyDistanceTolerance = 0.02;
+
+// Diagonal pairs first, so half the pixels have been redrawn after two frames
+bool temporalRefresh(ivec2 pixel) {
+    ivec2 inBlock = pixel & 1;
+    const int order[4] = int[4](0, 3, 1, 2);
+    return inBlock.x + 2 * inBlock.y == order[temporalFrame];
+}
+
+// Checkerboard variant, every other pixel redrawn each frame
+bool checkerboardRefresh(ivec2 pixel) {
+    return ((pixel.x + pixel.y + temporalFrame) & 1) == 0;
+}
+
+// Last frame's texel showing a point, which moves with the planet if it is on it. False off screen.
+bool reprojectHistory(vec3 worldPos, bool onPlanet, out vec4 value, out vec3 previousPos) {
+    value = vec4(0.0);
+    previousPos = onPlanet ? (previousModelFromModel * vec4(worldPos, 1.0)).xyz : worldPos;
+    if (!historyValid) return false;
+    vec4 clip = previousViewProjection * vec4(previousPos, 1.0);
+    if (clip.w <= 0.0) return false;
+    vec2 previousUv = clip.xy / clip.w * 0.5 + 0.5;
+    if (any(lessThan(previousUv, vec2(0.0))) || any(greaterThanEqual(previousUv, vec2(1.0)))) return false;
+    value = texelFetch(history, ivec2(previousUv * vec2(textureSize(history, 0))), 0);
+    return true;
+}
+
+// Last frame's value of a point seen at distanceToCamera, for histories holding that distance in alpha.
+// Also rejected where last frame's distance shows it saw the sky or another surface instead.
+bool fetchHistory(vec3 worldPos, bool onPlanet, float distanceToCamera, out vec3 value) {
+    vec4 previous;
+    vec3 previousPos;
+    value = vec3(0.0);
+    if (!reprojectHistory(worldPos, onPlanet, previous, previousPos)) return false;
+    float expected = onPlanet ? length(previousPos - previousCameraPos) : distanceToCamera;
+    if (abs(previous.a - expected) > historyDistanceTolerance * expected) return false;
+    value = previous.rgb;
+    return true;
+}
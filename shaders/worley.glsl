@@ -0,0 +1,71 @@
+
+// Cellular (Worley) noise, one feature point per cell.
+// rgb = feature point offset inside the cell, a = permutation used to hash cell coordinates
+// (built on the CPU from the seed, see WorleyFeatureTable)
+uniform sampler2D worleyTable;
+
+// Neighbour cells ordered by how close they can possibly be (cell, faces, edges, corners),
+// so the distance bound below rejects most of the far ones
+const ivec3 worleyOffsets[27] = ivec3[27](
+    ivec3( 0, 0, 0),
+    ivec3(-1, 0, 0), ivec3( 1, 0, 0), ivec3( 0,-1, 0), ivec3( 0, 1, 0), ivec3( 0, 0,-1), ivec3( 0, 0, 1),
+    ivec3(-1,-1, 0), ivec3( 1,-1, 0), ivec3(-1, 1, 0), ivec3( 1, 1, 0),
+    ivec3(-1, 0,-1), ivec3( 1, 0,-1), ivec3(-1, 0, 1), ivec3( 1, 0, 1),
+    ivec3( 0,-1,-1), ivec3( 0, 1,-1), ivec3( 0,-1, 1), ivec3( 0, 1, 1),
+    ivec3(-1,-1,-1), ivec3( 1,-1,-1), ivec3(-1, 1,-1), ivec3( 1, 1,-1),
+    ivec3(-1,-1, 1), ivec3( 1,-1, 1), ivec3(-1, 1, 1), ivec3( 1, 1, 1)
+);
+
+int worleyPerm(int i) {
+    return int(texelFetch(worleyTable, ivec2(i & 255, 0), 0).a);
+}
+
+vec3 worleyFeaturePoint(ivec3 cell) {
+    int h = worleyPerm(worleyPerm(worleyPerm(cell.x) + cell.y) + cell.z);
+    return texelFetch(worleyTable, ivec2(h, 0), 0).rgb;
+}
+
+// Distances to the closest and second closest feature point
+vec2 worleyNoise(vec3 pos, bool needF2) {
+    vec3 cellPos = floor(pos);
+    ivec3 cell = ivec3(cellPos);
+    vec3 f = pos - cellPos;
+
+    float f1 = 1e10;
+    float f2 = 1e10;
+    for (int i = 0; i < 27; i++) {
+        ivec3 o = worleyOffsets[i];
+
+        // closest any point of that cell can be, skip it if it can't beat what we have
+        vec3 bound = mix(vec3(0.0), mix(f, 1.0 - f, step(0.0, vec3(o))), abs(vec3(o)));
+        if (dot(bound, bound) >= (needF2 ? f2 : f1)) continue;
+
+        vec3 d = vec3(o) + worleyFeaturePoint(cell + o) - f;
+        float d2 = dot(d, d);
+        if (d2 < f1) {
+            f2 = f1;
+            f1 = d2;
+        } else if (d2 < f2) {
+            f2 = d2;
+        }
+    }
+    return sqrt(vec2(f1, f2));
+}
+
+// output: 0 = F1, 1 = F2, 2 = F2 - F1 (same as WorleyOutput). At most maxOctaves are summed, like GenerateNoise.
+float GenerateWorleyNoise(vec3 pointOnUnitSphere, float frequency, float persistence, float octaves, float roughness, float scaling, int worleyOutput, int maxOctaves)
+{
+    float noise = 0.0;
+    int octaveCount = int(ceil(octaves));
+    for (int i = 0; i < maxOctaves; i++)
+    {
+        if (i >= octaveCount) break;
+        float fade = min(octaves - float(i), 1.0);
+        vec2 d = worleyNoise(pointOnUnitSphere * frequency, worleyOutput != 0);
+        float v = worleyOutput == 0 ? d.x : (worleyOutput == 1 ? d.y : d.y - d.x);
+        noise += (v * 2.0 - 1.0) * scaling * fade;
+        frequency *= roughness;
+        scaling *= persistence;
+    }
+    return noise;
+}
@@ -0,0 +1,273 @@
+#include "atmosphereLut.h"
+#include <algorithm>
+#include <cmath>
+#include "threadPool.h"
+
+namespace {
+    const int bakeSteps = 256;
+    // Directions and steps along each of them gathering light at a multiple scattering texel
+    const int multiScatteringDirections = 64;
+    const int multiScatteringSteps = 20;
+    // Rays through the planet get enormous depths, capped so linear filtering between texels stays finite
+    const float maxOpticalDepth = 1e4f;
+
+    // The ends of [0, 1] map onto the outer texel centers
+    float ToTexel(float x01, int size) {
+        return (0.5f + x01 * (size - 1)) / size;
+    }
+
+    // Chapman function for zenith cosines from 0 up, x is the radius in scale heights.
+    // The large x asymptote sqrt(pi x / 2) erfcx(sqrt(x / 2) cosZenith) with a rational fit of erfcx
+    // and a 1 / x correction, within about 1% of the exact function from x = 8 up.
+    float ChapmanUpper(float x, float cosZenith) {
+        float y = std::sqrt(0.5f * x) * cosZenith;
+        float correction = 1.0f + (0.45f + 0.3f * cosZenith * cosZenith) / x;
+        return std::sqrt(2.0f * x) / (1.275f * y + std::sqrt(0.525625f * y * y + 1.2732395f)) * correction;
+    }
+
+    // Density relative to the surface, capped far inside the planet where the light is long gone anyway
+    float RelativeDensity(float radius, float planetRadius, float scaleHeight) {
+        return std::exp(std::min((planetRadius - radius) / scaleHeight, 50.0f));
+    }
+
+    // Optical depth to infinity of an exponential atmosphere that doesn't stop at the top
+    float ChapmanToInfinity(float radius, float cosZenith, float planetRadius, float scaleHeight) {
+        float x = radius / scaleHeight;
+        if (cosZenith >= 0.0f) {
+            return RelativeDensity(radius, planetRadius, scaleHeight) * scaleHeight * ChapmanUpper(x, cosZenith);
+        }
+        // Below the horizon it's both ways from the lowest point of the ray minus the way back up
+        float lowest = radius * std::sqrt(std::max(0.0f, 1.0f - cosZenith * cosZenith));
+        return scaleHeight * (2.0f * RelativeDensity(lowest, planetRadius, scaleHeight) * ChapmanUpper(lowest / scaleHeight, 0.0f) -
+            RelativeDensity(radius, planetRadius, scaleHeight) * ChapmanUpper(x, -cosZenith));
+    }
+
+    // Zenith cosine of the horizon seen from a height in [0, 1]
+    float HorizonCos(const AtmosphereParams& params, float height01) {
+        float radius = params.planetRadius + height01 * (params.atmosphereRadius - params.planetRadius);
+        float ratio = params.planetRadius / radius;
+        return -std::sqrt(std::max(0.0f, 1.0f - ratio * ratio));
+    }
+}
+
+float AtmosphereDensity(const AtmosphereParams& params, float radius) {
+    float height01 = (radius - params.planetRadius) / (params.atmosphereRadius - params.planetRadius);
+    return std::exp(-height01 * params.densityFalloff / params.scaleDepth);
+}
+
+double RayOpticalDepth(const AtmosphereParams& params, double radius, double cosZenith, int steps) {
+    double atmosphereRadius = params.atmosphereRadius;
+    double length = -radius * cosZenith +
+        std::sqrt(std::max(0.0, atmosphereRadius * atmosphereRadius - radius * radius * (1.0 - cosZenith * cosZenith)));
+    double stepSize = length / steps;
+    double thickness = params.atmosphereRadius - params.planetRadius;
+    double falloff = params.densityFalloff / params.scaleDepth;
+    double depth = 0.0;
+    for (int i = 0; i < steps; i++) {
+        double t = (i + 0.5) * stepSize;
+        double r = std::sqrt(radius * radius + 2.0 * radius * cosZenith * t + t * t);
+        depth += std::exp(-(r - params.planetRadius) / thickness * falloff) * stepSize;
+    }
+    return depth;
+}
+
+float ChapmanOpticalDepth(const AtmosphereParams& params, float radius, float cosZenith) {
+    // Density falls by e every scale height, a falloff of 0 is an even density that never ends
+    float scaleHeight = (params.atmosphereRadius - params.planetRadius) * params.scaleDepth / std::max(params.densityFalloff, 0.01f);
+    // Take away what lies past the top of the atmosphere, from where the ray leaves it
+    float sinZenith2 = std::max(0.0f, 1.0f - cosZenith * cosZenith);
+    float exitCos = std::sqrt(std::max(0.0f, 1.0f - radius * radius * sinZenith2 / (params.atmosphereRadius * params.atmosphereRadius)));
+    float depth = ChapmanToInfinity(radius, cosZenith, params.planetRadius, scaleHeight) -
+        ChapmanToInfinity(params.atmosphereRadius, exitCos, params.planetRadius, scaleHeight);
+    return std::max(depth, 0.0f);
+}
+
+// Square roots of the distance to the horizon and of the height put more texels where the depth changes fastest
+void TransmittanceLutCoord(const AtmosphereParams& params, float height01, float cosZenith, float& u, float& v) {
+    height01 = std::clamp(height01, 0.0f, 1.0f);
+    float horizon = HorizonCos(params, height01);
+    float x = cosZenith >= horizon ?
+        0.5f + 0.5f * std::sqrt(std::min((cosZenith - horizon) / (1.0f - horizon), 1.0f)) :
+        0.5f - 0.5f * std::sqrt(std::min((horizon - cosZenith) / (1.0f + horizon), 1.0f));
+    u = ToTexel(x, TransmittanceLut::width);
+    v = ToTexel(std::sqrt(height01), TransmittanceLut::height);
+}
+
+float TransmittanceLut::Sample(float height01, float cosZenith) const {
+    float u, v;
+    TransmittanceLutCoord(params, height01, cosZenith, u, v);
+    float x = std::clamp(u * width - 0.5f, 0.0f, width - 1.0f);
+    float y = std::clamp(v * height - 0.5f, 0.0f, height - 1.0f);
+    int x0 = std::min(static_cast<int>(x), width - 2);
+    int y0 = std::min(static_cast<int>(y), height - 2);
+    float fx = x - x0, fy = y - y0;
+    const float* row0 = &texels[y0 * width];
+    const float* row1 = row0 + width;
+    float top = row0[x0] + (row0[x0 + 1] - row0[x0]) * fx;
+    float bottom = row1[x0] + (row1[x0 + 1] - row1[x0]) * fx;
+    return top + (bottom - top) * fy;
+}
+
+bool BakeTransmittanceLut(const AtmosphereParams& params, TransmittanceLut& lut, const std::atomic<bool>* cancel) {
+    lut.params = params;
+    lut.texels.resize(TransmittanceLut::width * TransmittanceLut::height);
+    const double thickness = params.atmosphereRadius - params.planetRadius;
+    ThreadPool::Shared().ParallelFor(TransmittanceLut::height, [&](int y) {
+        if (cancel && *cancel) return;
+        float v01 = static_cast<float>(y) / (TransmittanceLut::height - 1);
+        float horizon = HorizonCos(params, v01 * v01);
+        double radius = params.planetRadius + v01 * v01 * thickness;
+        for (int x = 0; x < TransmittanceLut::width; x++) {
+            // Inverse of TransmittanceLutCoord
+            double x11 = 2.0 * x / (TransmittanceLut::width - 1) - 1.0;
+            double cosZenith = x11 >= 0.0 ? horizon + x11 * x11 * (1.0 - horizon) : horizon - x11 * x11 * (1.0 + horizon);
+            double depth = RayOpticalDepth(params, radius, cosZenith, bakeSteps) / thickness;
+            lut.texels[y * TransmittanceLut::width + x] = static_cast<float>(std::min(depth, static_cast<double>(maxOpticalDepth)));
+        }
+    });
+    return !(cancel && *cancel);
+}
+
+glm::vec3 MultiScatteringLut::Sample(float height01, float cosSunZenith) const {
+    float x = std::clamp(0.5f + 0.5f * cosSunZenith, 0.0f, 1.0f) * (size - 1);
+    float y = std::clamp(height01, 0.0f, 1.0f) * (size - 1);
+    int x0 = std::min(static_cast<int>(x), size - 2);
+    int y0 = std::min(static_cast<int>(y), size - 2);
+    float fx = x - x0, fy = y - y0;
+    const glm::vec3* row0 = &texels[y0 * size];
+    const glm::vec3* row1 = row0 + size;
+    glm::vec3 top = row0[x0] + (row0[x0 + 1] - row0[x0]) * fx;
+    glm::vec3 bottom = row1[x0] + (row1[x0 + 1] - row1[x0]) * fx;
+    return top + (bottom - top) * fy;
+}
+
+bool BakeMultiScatteringLut(const TransmittanceLut& transmittance, const glm::vec3& extinction, MultiScatteringLut& lut,
+    const std::atomic<bool>* cancel) {
+    const AtmosphereParams& params = transmittance.params;
+    const float thickness = params.atmosphereRadius - params.planetRadius;
+
+    // Evenly spread over the sphere on a Fibonacci spiral
+    std::vector<glm::vec3> directions(multiScatteringDirections);
+    for (int i = 0; i < multiScatteringDirections; i++) {
+        float y = 1.0f - (2.0f * i + 1.0f) / multiScatteringDirections;
+        float ring = std::sqrt(1.0f - y * y);
+        float angle = 2.3999632f * i;
+        directions[i] = glm::vec3(ring * std::cos(angle), y, ring * std::sin(angle));
+    }
+
+    lut.texels.resize(MultiScatteringLut::size * MultiScatteringLut::size);
+    ThreadPool::Shared().ParallelFor(MultiScatteringLut::size, [&](int y) {
+        if (cancel && *cancel) return;
+        float height01 = static_cast<float>(y) / (MultiScatteringLut::size - 1);
+        glm::vec3 origin(0.0f, params.planetRadius + height01 * thickness, 0.0f);
+        for (int x = 0; x < MultiScatteringLut::size; x++) {
+            float cosSun = 2.0f * x / (MultiScatteringLut::size - 1) - 1.0f;
+            glm::vec3 sunDir(std::sqrt(std::max(0.0f, 1.0f - cosSun * cosSun)), cosSun, 0.0f);
+
+            // Second order light reaching the texel, and the fraction of light from all around it scatters back to itself.
+            // The channels are independent, vec3 keeps them together.
+            glm::vec3 secondOrder(0.0f), transfer(0.0f);
+            for (const glm::vec3& dir : directions) {
+                // Up to the ground or the top of the atmosphere
+                float b = glm::dot(origin, dir);
+                float c = glm::dot(origin, origin);
+                float groundDet = b * b - c + params.planetRadius * params.planetRadius;
+                float length = b < 0.0f && groundDet >= 0.0f ? -b - std::sqrt(groundDet) :
+                    -b + std::sqrt(std::max(0.0f, b * b - c + params.atmosphereRadius * params.atmosphereRadius));
+                float stepSize = length / multiScatteringSteps;
+
+                glm::vec3 viewTransmittance(1.0f);
+                for (int i = 0; i < multiScatteringSteps; i++) {
+                    glm::vec3 point = origin + dir * ((i + 0.5f) * stepSize);
+                    float radius = glm::length(point);
+                    glm::vec3 scattering = AtmosphereDensity(params, radius) * extinction;
+                    glm::vec3 stepTransmittance = glm::exp(-scattering * stepSize);
+                    // Exact integral of transmittance * scattering over the step, so thick steps don't gain energy
+                    glm::vec3 scattered = viewTransmittance * (1.0f - stepTransmittance);
+                    float sunDepth = transmittance.Sample((radius - params.planetRadius) / thickness, glm::dot(point, sunDir) / radius) * thickness;
+                    secondOrder += scattered * glm::exp(-sunDepth * extinction);
+                    transfer += scattered;
+                    viewTransmittance = viewTransmittance * stepTransmittance;
+                }
+            }
+            secondOrder = secondOrder / static_cast<float>(multiScatteringDirections);
+            transfer = transfer / static_cast<float>(multiScatteringDirections);
+
+            // Every further order is the previous one times transfer, the geometric series sums to this
+            lut.texels[y * MultiScatteringLut::size + x] = secondOrder / (1.0f - glm::min(transfer, 0.99f));
+        }
+    });
+    return !(cancel && *cancel);
+}
+
+AtmosphereLutJob::~AtmosphereLutJob() {
+    Cancel();
+}
+
+void AtmosphereLutJob::Start(const AtmosphereParams& params, const glm::vec3& extinction) {
+    if (started && startedParams == params && startedExtinction == extinction) return;
+    started = true;
+    startedParams = params;
+    startedExtinction = extinction;
+
+    // Stale bakes are told to stop but not waited for, they return within a row
+    for (Bake& bake : bakes) {
+        *bake.cancel = true;
+    }
+    bakes.erase(std::remove_if(bakes.begin(), bakes.end(), [](const Bake& bake) {
+        return bake.task.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+    }), bakes.end());
+
+    unsigned bakeGeneration = ++generation;
+    Bake bake;
+    bake.cancel = std::make_shared<std::atomic<bool>>(false);
+    // The pool task owns its flag, the ParallelFor calls inside it pitch in rather than block a worker
+    bake.task = ThreadPool::Shared().Submit([this, cancel = bake.cancel, bakeGeneration, params, extinction]() {
+        TransmittanceLut transmittance;
+        MultiScatteringLut multiScattering;
+        if (!BakeTransmittanceLut(params, transmittance, cancel.get())) return;
+        if (!BakeMultiScatteringLut(transmittance, extinction, multiScattering, cancel.get())) return;
+
+        std::lock_guard<std::mutex> lock(resultMutex);
+        // Finished just as a newer one started
+        if (bakeGeneration != generation) return;
+        transmittanceResult = std::move(transmittance);
+        multiScatteringResult = std::move(multiScattering);
+        hasResult = true;
+    });
+    bakes.push_back(std::move(bake));
+}
+
+void AtmosphereLutJob::Cancel() {
+    ++generation;
+    for (Bake& bake : bakes) {
+        *bake.cancel = true;
+    }
+    for (Bake& bake : bakes) {
+        bake.task.wait();
+    }
+    bakes.clear();
+    started = false;
+    std::lock_guard<std::mutex> lock(resultMutex);
+    hasResult = false;
+}
+
+void AtmosphereLutJob::Wait() {
+    if (!bakes.empty()) bakes.back().task.wait();
+}
+
+bool AtmosphereLutJob::IsRunning() const {
+    for (const Bake& bake : bakes) {
+        if (bake.task.wait_for(std::chrono::seconds(0)) != std::future_status::ready) return true;
+    }
+    return false;
+}
+
+bool AtmosphereLutJob::TakeResult(TransmittanceLut& transmittance, MultiScatteringLut& multiScattering) {
+    std::lock_guard<std::mutex> lock(resultMutex);
+    if (!hasResult) return false;
+    transmittance = std::move(transmittanceResult);
+    multiScattering = std::move(multiScatteringResult);
+    hasResult = false;
+    return true;
+}
@@ -0,0 +1,93 @@
+#pragma once
+#include <atomic>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include <glm/glm.hpp>
+
+// What the density of the atmosphere in scattering.glsl depends on
+struct AtmosphereParams {
+    float planetRadius = 1.0f;
+    float atmosphereRadius = 1.25f;
+    float densityFalloff = 1.0f;
+    float scaleDepth = 0.25f; // the average density is found this far from ground to atmosphere
+
+    bool operator==(const AtmosphereParams& other) const {
+        return planetRadius == other.planetRadius && atmosphereRadius == other.atmosphereRadius &&
+            densityFalloff == other.densityFalloff && scaleDepth == other.scaleDepth;
+    }
+    bool operator!=(const AtmosphereParams& other) const { return !(*this == other); }
+};
+
+// Optical depth from a point to the top of the atmosphere, over the cosine of the angle between the ray
+// and the zenith (x) and the height above the surface (y). Depths are in units of the atmosphere thickness.
+// Rays below the horizon go on through the planet like the ray marched ones in scattering.glsl, so the
+// depth shoots up just past the horizon. The left half of the table is below it, the right half above.
+struct TransmittanceLut {
+    static const int width = 256;
+    static const int height = 64;
+    AtmosphereParams params; // what it was baked for
+    std::vector<float> texels; // row by row, R32F
+
+    float Sample(float height01, float cosZenith) const; // bilinear, like the GPU
+};
+
+// Light scattered two or more times, after Hillaire's "A Scalable and Production Ready Sky and Atmosphere
+// Rendering Technique" (2020), over the cosine of the sun zenith angle (x) and the height above the surface (y).
+// Higher orders are taken to be isotropic, so per unit of sunlight a point sends its scattering coefficient
+// times this towards the eye. All of the extinction counts as scattering, like Rayleigh scattering.
+struct MultiScatteringLut {
+    static const int size = 32;
+    std::vector<glm::vec3> texels; // row by row, RGB32F
+
+    glm::vec3 Sample(float height01, float cosSunZenith) const; // bilinear, like the GPU
+};
+
+// Density at a distance from the planet center, keep in sync with densityAtPoint in scattering.glsl
+float AtmosphereDensity(const AtmosphereParams& params, float radius);
+// Optical depth (in world units) from a point at a distance from the planet center to the top of the atmosphere,
+// integrated with the midpoint rule
+double RayOpticalDepth(const AtmosphereParams& params, double radius, double cosZenith, int steps);
+// Same as RayOpticalDepth from an analytic approximation of the Chapman function, keep in sync with chapmanOpticalDepth in scattering.glsl
+float ChapmanOpticalDepth(const AtmosphereParams& params, float radius, float cosZenith);
+// Texture coordinates of a height in [0, 1] and zenith cosine, keep in sync with transmittanceLutCoord in scattering.glsl
+void TransmittanceLutCoord(const AtmosphereParams& params, float height01, float cosZenith, float& u, float& v);
+// Fills the table, spread over the thread pool. Returns false if cancelled, the table is left half done then.
+bool BakeTransmittanceLut(const AtmosphereParams& params, TransmittanceLut& lut, const std::atomic<bool>* cancel = nullptr);
+// Fills the table for the atmosphere the transmittance LUT was baked for, extinction is invWavelength4 per unit density
+bool BakeMultiScatteringLut(const TransmittanceLut& transmittance, const glm::vec3& extinction, MultiScatteringLut& lut,
+    const std::atomic<bool>* cancel = nullptr);
+
+// Bakes both tables on the thread pool while the old ones stay in use. Every start makes the bakes before it stale:
+// they stop at their next row and their tables are dropped, only the newest start's tables are ever handed out.
+class AtmosphereLutJob {
+public:
+    ~AtmosphereLutJob();
+
+    // Starts a bake unless the newest one is already for the same atmosphere
+    void Start(const AtmosphereParams& params, const glm::vec3& extinction);
+    // Stops every bake and waits for them to return
+    void Cancel();
+    // Blocks until the newest bake is done
+    void Wait();
+    bool IsRunning() const;
+    // Moves the newest finished tables out; false if nothing finished since the last call
+    bool TakeResult(TransmittanceLut& transmittance, MultiScatteringLut& multiScattering);
+
+private:
+    struct Bake {
+        std::shared_ptr<std::atomic<bool>> cancel;
+        std::future<void> task;
+    };
+    std::vector<Bake> bakes; // the newest last, stale ones stay until they've returned
+    std::atomic<unsigned> generation{ 0 }; // of the newest start, older bakes don't hand in their tables
+    bool started = false;
+    AtmosphereParams startedParams;
+    glm::vec3 startedExtinction = glm::vec3(0.0f);
+
+    std::mutex resultMutex;
+    bool hasResult = false;
+    TransmittanceLut transmittanceResult;
+    MultiScatteringLut multiScatteringResult;
+};
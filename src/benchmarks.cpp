@@ -0,0 +1,258 @@
+#include "benchmarks.h"
+#include "worleyNoiseFilter.h"
+#include "craterNoiseFilter.h"
+#include "plateNoiseFilter.h"
+#include "cubeMap.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <random>
+#include <vector>
+
+namespace Benchmarks {
+
+    namespace {
+        using Clock = std::chrono::high_resolution_clock;
+
+        double MillisecondsSince(Clock::time_point start) {
+            return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+        }
+
+        std::vector<glm::vec3> RandomPointsOnSphere(int count, float radius) {
+            std::mt19937 rng(1234);
+            std::normal_distribution<float> gauss;
+            std::vector<glm::vec3> points(count);
+            for (glm::vec3& p : points) {
+                p = glm::normalize(glm::vec3(gauss(rng), gauss(rng), gauss(rng))) * radius;
+            }
+            return points;
+        }
+
+        NoiseLayer CraterLayer(int craterCount) {
+            NoiseLayer layer;
+            layer.type = NoiseType::Craters;
+            layer.featureCount = craterCount;
+            layer.minFeatureSize = 0.002f;
+            layer.maxFeatureSize = 0.3f;
+            return layer;
+        }
+
+        // Per sample cost the crater lookups have to stay under at a million craters
+        const double craterSampleBudgetMs = 0.002;
+
+        // Results nobody reads go here, so the timed loops aren't optimised away
+        volatile float sink;
+    }
+
+    Result WorleyVsBruteForce(float seed, int samples) {
+        NoiseLayer layer;
+        layer.type = NoiseType::Worley;
+        layer.worleyOutput = WorleyOutput::F2MinusF1; // needs F2, so the bound is the weakest
+        WorleyNoiseFilter filter(layer, seed);
+
+        // Roughly the cell density of a high frequency octave
+        std::vector<glm::vec3> points = RandomPointsOnSphere(samples, 8.0f);
+        std::vector<glm::vec2> fast(samples), reference(samples);
+
+        Result result;
+        result.name = "Worley F1/F2";
+        result.samples = samples;
+
+        Clock::time_point start = Clock::now();
+        for (int i = 0; i < samples; i++) {
+            fast[i] = filter.Distances(points[i]);
+        }
+        result.milliseconds = MillisecondsSince(start);
+
+        start = Clock::now();
+        for (int i = 0; i < samples; i++) {
+            reference[i] = filter.DistancesBruteForce(points[i]);
+        }
+        result.referenceMilliseconds = MillisecondsSince(start);
+
+        for (int i = 0; i < samples; i++) {
+            result.maxError = std::max(result.maxError, (double)std::abs(fast[i].x - reference[i].x));
+            result.maxError = std::max(result.maxError, (double)std::abs(fast[i].y - reference[i].y));
+        }
+        return result;
+    }
+
+    Result CratersVsBruteForce(float seed, int craterCount, int samples) {
+        Result result;
+        result.name = "Craters " + std::to_string(craterCount);
+        result.samples = samples;
+
+        Clock::time_point start = Clock::now();
+        CraterNoiseFilter field(CraterLayer(craterCount), seed);
+        result.setupMilliseconds = MillisecondsSince(start);
+
+        std::vector<glm::vec3> points = RandomPointsOnSphere(samples, 1.0f);
+        std::vector<float> fast(samples), reference(samples);
+
+        start = Clock::now();
+        for (int i = 0; i < samples; i++) {
+            fast[i] = field.Height(points[i]);
+        }
+        result.milliseconds = MillisecondsSince(start);
+
+        start = Clock::now();
+        for (int i = 0; i < samples; i++) {
+            reference[i] = field.HeightBruteForce(points[i]);
+        }
+        result.referenceMilliseconds = MillisecondsSince(start);
+
+        for (int i = 0; i < samples; i++) {
+            result.maxError = std::max(result.maxError, (double)std::abs(fast[i] - reference[i]));
+        }
+        return result;
+    }
+
+    Result CraterFieldBudget(float seed, int craterCount, int faceResolution) {
+        Result result;
+        result.name = "Crater field " + std::to_string(craterCount);
+        result.samples = CubeMap::faceCount * faceResolution * faceResolution;
+        result.budgetMilliseconds = result.samples * craterSampleBudgetMs;
+
+        Clock::time_point start = Clock::now();
+        CraterNoiseFilter field(CraterLayer(craterCount), seed);
+        result.setupMilliseconds = MillisecondsSince(start);
+
+        float sum = 0.0f;
+        start = Clock::now();
+        for (int face = 0; face < CubeMap::faceCount; face++) {
+            for (int y = 0; y < faceResolution; y++) {
+                for (int x = 0; x < faceResolution; x++) {
+                    glm::vec3 p = glm::normalize(CubeMap::Direction(face, CubeMap::TexelCenter(x, y, faceResolution)));
+                    sum += field.Height(p);
+                }
+            }
+        }
+        result.milliseconds = MillisecondsSince(start);
+        sink = sum;
+        return result;
+    }
+
+    Result PlatesVsBruteForce(float seed, int plateCount, int samples) {
+        Result result;
+        result.name = "Plate lookup " + std::to_string(plateCount);
+        result.samples = samples;
+
+        NoiseLayer layer;
+        layer.type = NoiseType::Plates;
+        layer.featureCount = plateCount;
+
+        Clock::time_point start = Clock::now();
+        PlateNoiseFilter plates(layer, seed);
+        result.setupMilliseconds = MillisecondsSince(start);
+
+        const SphericalDelaunay& triangulation = plates.GetTriangulation();
+        const std::vector<glm::vec3>& sites = triangulation.GetSites();
+        std::vector<glm::vec3> points = RandomPointsOnSphere(samples, 1.0f);
+
+        std::vector<int> fast(samples), reference(samples);
+        start = Clock::now();
+        for (int i = 0; i < samples; i++) {
+            fast[i] = triangulation.Locate(points[i]);
+        }
+        result.milliseconds = MillisecondsSince(start);
+
+        start = Clock::now();
+        for (int i = 0; i < samples; i++) {
+            reference[i] = triangulation.LocateBruteForce(points[i]);
+        }
+        result.referenceMilliseconds = MillisecondsSince(start);
+
+        // Sites the same distance away (to float precision) are both right, so compare the distances
+        for (int i = 0; i < samples; i++) {
+            double error = glm::dot(points[i], sites[reference[i]]) - glm::dot(points[i], sites[fast[i]]);
+            result.maxError = std::max(result.maxError, error);
+        }
+        return result;
+    }
+
+    Result ChapmanVsRayMarch(const AtmosphereParams& params, int samples) {
+        Result result;
+        result.name = "Chapman optical depth";
+        result.samples = samples;
+
+        // Heights through the atmosphere looking anywhere above the horizon, rays into the planet are dark either way
+        std::mt19937 rng(1234);
+        std::uniform_real_distribution<float> uniform(0.0f, 1.0f);
+        std::vector<float> radii(samples), cosZeniths(samples);
+        for (int i = 0; i < samples; i++) {
+            radii[i] = params.planetRadius + uniform(rng) * (params.atmosphereRadius - params.planetRadius);
+            float ratio = params.planetRadius / radii[i];
+            float horizon = -std::sqrt(1.0f - ratio * ratio);
+            cosZeniths[i] = horizon + uniform(rng) * (1.0f - horizon);
+        }
+
+        std::vector<float> fast(samples);
+        std::vector<double> reference(samples);
+        Clock::time_point start = Clock::now();
+        for (int i = 0; i < samples; i++) {
+            fast[i] = ChapmanOpticalDepth(params, radii[i], cosZeniths[i]);
+        }
+        result.milliseconds = MillisecondsSince(start);
+
+        start = Clock::now();
+        for (int i = 0; i < samples; i++) {
+            reference[i] = RayOpticalDepth(params, radii[i], cosZeniths[i], 4096);
+        }
+        result.referenceMilliseconds = MillisecondsSince(start);
+
+        // Near the top the depths go to 0, so small absolute differences don't count there
+        const double minDepth = 1e-3 * (params.atmosphereRadius - params.planetRadius);
+        for (int i = 0; i < samples; i++) {
+            double error = std::abs(fast[i] - reference[i]) / std::max(reference[i], minDepth);
+            result.maxError = std::max(result.maxError, error);
+        }
+        return result;
+    }
+
+    Result ScatteringVsReference(const ScatteringSettings& settings, int rays) {
+        Result result;
+        result.name = "Scattering";
+        result.samples = rays;
+
+        // Rays from the camera through points all over the atmosphere, across the limb and down onto the planet
+        const AtmosphereParams& params = settings.params;
+        std::vector<glm::vec3> targets = RandomPointsOnSphere(rays, 1.0f);
+        std::mt19937 rng(4321);
+        std::uniform_real_distribution<float> uniform(0.0f, 1.0f);
+        std::vector<glm::dvec3> directions(rays);
+        for (int i = 0; i < rays; i++) {
+            glm::vec3 target = targets[i] * (params.planetRadius + uniform(rng) * (params.atmosphereRadius - params.planetRadius));
+            directions[i] = glm::normalize(glm::dvec3(target - settings.cameraPos));
+        }
+
+        std::vector<glm::dvec3> fast(rays), reference(rays);
+        Clock::time_point start = Clock::now();
+        for (int i = 0; i < rays; i++) {
+            fast[i] = ScatteredLight(settings, directions[i]);
+        }
+        result.milliseconds = MillisecondsSince(start);
+
+        ScatteringSettings referenceSettings = settings;
+        referenceSettings.samples = 256;
+        referenceSettings.depthSamples = 128;
+        referenceSettings.opticalDepthMode = 0;
+        referenceSettings.matchShader = false;
+        start = Clock::now();
+        for (int i = 0; i < rays; i++) {
+            reference[i] = ScatteredLight(referenceSettings, directions[i]);
+        }
+        result.referenceMilliseconds = MillisecondsSince(start);
+
+        double brightest = 0.0;
+        for (const glm::dvec3& color : reference) {
+            brightest = std::max({ brightest, color.x, color.y, color.z });
+        }
+        for (int i = 0; i < rays; i++) {
+            for (int c = 0; c < 3; c++) {
+                result.maxError = std::max(result.maxError, std::abs(fast[i][c] - reference[i][c]) / std::max(brightest, 1e-12));
+            }
+        }
+        return result;
+    }
+
+}
@@ -0,0 +1,29 @@
+#pragma once
+#include <string>
+#include "atmosphereLut.h"
+#include "scatteringReference.h"
+
+// Small CPU benchmarks comparing the accelerated terrain code against
+// straightforward reference implementations. Run from the Benchmarks panel.
+namespace Benchmarks {
+    struct Result {
+        std::string name;
+        int samples = 0;
+        double milliseconds = 0.0;          // accelerated version
+        double referenceMilliseconds = 0.0; // reference version
+        double maxError = 0.0;              // largest difference between the two
+        double setupMilliseconds = 0.0;     // building any acceleration structure
+        double budgetMilliseconds = 0.0;    // what the accelerated version has to stay under, if anything
+    };
+
+    Result WorleyVsBruteForce(float seed, int samples = 200000);
+    Result CratersVsBruteForce(float seed, int craterCount = 100000, int samples = 2000);
+    // Crater lookups over a cube face grid (like a heightmap bake) at a million craters
+    Result CraterFieldBudget(float seed, int craterCount = 1000000, int faceResolution = 128);
+    // Voronoi cell lookups through the Delaunay walk against testing every site, setup builds the plates
+    Result PlatesVsBruteForce(float seed, int plateCount = 20000, int samples = 20000);
+    // Chapman function optical depths against a finely stepped ray march, error relative to the depth
+    Result ChapmanVsRayMarch(const AtmosphereParams& params, int samples = 20000);
+    // Scattered light the way the shader works it out against finely stepped exact ray marches, error relative to the brightest ray
+    Result ScatteringVsReference(const ScatteringSettings& settings, int rays = 1000);
+}
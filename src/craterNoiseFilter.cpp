@@ -0,0 +1,187 @@
+#include "craterNoiseFilter.h"
+#include "cubeMap.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <random>
+
+namespace {
+    // Bowl with a raised rim, d is the distance from the center in crater radii.
+    // Keep in sync with craterProfile in craters.glsl.
+    float CraterProfile(float d) {
+        const float floorHeight = -0.6f;
+        const float rimWidth = CraterNoiseFilter::rimExtent - 1.0f;
+        const float rimSteepness = 0.4f;
+
+        float cavity = d * d - 1.0f;
+        float rimX = std::min(d - 1.0f - rimWidth, 0.0f);
+        float rim = rimSteepness * rimX * rimX;
+        return std::min(std::max(cavity, floorHeight), rim);
+    }
+
+    // Crater depth relative to its radius
+    const float depthRatio = 0.25f;
+
+    const float halfPi = 1.5707963f;
+
+    // Angle at which the chord distance used by CraterContribution reaches the rim
+    float InfluenceAngle(float radius) {
+        return 2.0f * std::asin(std::min(radius * CraterNoiseFilter::rimExtent * 0.5f, 1.0f));
+    }
+
+    // Deepest quadtree level whose cells (at the center of a face) are at least as wide as
+    // the radius of the crater's area of influence, so it overlaps only a few of them
+    int CraterLevel(float influenceAngle) {
+        int level = 0;
+        while (level + 1 < CraterNoiseFilter::maxLevels && halfPi / (1 << (level + 1)) >= influenceAngle) {
+            level++;
+        }
+        return level;
+    }
+}
+
+CraterNoiseFilter::CraterNoiseFilter(const NoiseLayer& settings, float seed) : settings(settings) {
+    Scatter(seed);
+    BuildIndex();
+}
+
+void CraterNoiseFilter::Scatter(float seed) {
+    uint32_t seedBits;
+    std::memcpy(&seedBits, &seed, sizeof(seedBits));
+    std::mt19937 rng(seedBits ^ 0x9e3779b9u);
+    std::normal_distribution<float> gauss;
+    std::uniform_real_distribution<float> uniform(0.0f, 1.0f);
+
+    // Inverse transform sampling of N(>r) ~ r^-sizeExponent between the min and max size
+    float minSize = std::max(settings.minFeatureSize, 1e-4f);
+    float maxSize = std::max(settings.maxFeatureSize, minSize);
+    float exponent = std::max(settings.sizeExponent, 0.01f);
+    float minPow = std::pow(minSize, -exponent);
+    float maxPow = std::pow(maxSize, -exponent);
+
+    craters.resize(std::max(settings.featureCount, 0));
+    for (glm::vec4& crater : craters) {
+        glm::vec3 center = glm::normalize(glm::vec3(gauss(rng), gauss(rng), gauss(rng)));
+        float radius = std::pow(minPow - uniform(rng) * (minPow - maxPow), -1.0f / exponent);
+        crater = glm::vec4(center, radius);
+    }
+}
+
+void CraterNoiseFilter::BuildIndex() {
+    int craterCount = static_cast<int>(craters.size());
+    std::vector<int> levels(craterCount);
+    minLevel = maxLevels - 1;
+    maxLevel = 0;
+    for (int i = 0; i < craterCount; i++) {
+        levels[i] = CraterLevel(InfluenceAngle(craters[i].w));
+        minLevel = std::min(minLevel, levels[i]);
+        maxLevel = std::max(maxLevel, levels[i]);
+    }
+    if (craterCount == 0) minLevel = maxLevel = 0;
+    int cellCount = LevelStart(maxLevel + 1);
+
+    // Find the cells each crater overlaps on its level: walk the edge of its area of influence and
+    // take the bounding box of the face coordinates on each face it touches. The box is grown by
+    // how far the true circle can bulge out between two samples, so no overlapped cell is missed.
+    std::vector<std::pair<int, int>> entries; // (cell, crater)
+    entries.reserve(craters.size() * 4);
+    const int samples = 32;
+    const float sampleBulge = 1.0f - std::cos(3.1415927f / samples);
+    for (int i = 0; i < craterCount; i++) {
+        glm::vec3 center = glm::vec3(craters[i]);
+        float extent = InfluenceAngle(craters[i].w);
+        int level = levels[i];
+        int resolution = 1 << level;
+
+        glm::vec3 tangent = glm::normalize(glm::cross(center, std::abs(center.y) < 0.9f ? glm::vec3(0, 1, 0) : glm::vec3(1, 0, 0)));
+        glm::vec3 bitangent = glm::cross(center, tangent);
+
+        glm::vec2 minUV[CubeMap::faceCount], maxUV[CubeMap::faceCount];
+        bool touched[CubeMap::faceCount] = {};
+        auto addSample = [&](const glm::vec3& p) {
+            glm::vec2 uv;
+            int face = CubeMap::FaceCoords(p, uv);
+            minUV[face] = touched[face] ? glm::min(minUV[face], uv) : uv;
+            maxUV[face] = touched[face] ? glm::max(maxUV[face], uv) : uv;
+            touched[face] = true;
+        };
+
+        addSample(center);
+        for (int s = 0; s < samples; s++) {
+            float angle = 6.2831853f * s / samples;
+            glm::vec3 direction = std::cos(angle) * tangent + std::sin(angle) * bitangent;
+            addSample(std::cos(extent) * center + std::sin(extent) * direction);
+        }
+
+        // face coordinates change by at most 3 per radian (at the corners)
+        float margin = 3.0f * extent * sampleBulge;
+        for (int face = 0; face < CubeMap::faceCount; face++) {
+            if (!touched[face]) continue;
+            int x0 = CubeMap::CoordToTexel(minUV[face].x - margin, resolution);
+            int x1 = CubeMap::CoordToTexel(maxUV[face].x + margin, resolution);
+            int y0 = CubeMap::CoordToTexel(minUV[face].y - margin, resolution);
+            int y1 = CubeMap::CoordToTexel(maxUV[face].y + margin, resolution);
+            for (int y = y0; y <= y1; y++) {
+                for (int x = x0; x <= x1; x++) {
+                    entries.emplace_back(LevelStart(level) + (face * resolution + y) * resolution + x, i);
+                }
+            }
+        }
+    }
+
+    // Counting sort by cell into one flat list
+    cellOffsets.assign(cellCount + 1, 0);
+    for (const auto& entry : entries) {
+        cellOffsets[entry.first + 1]++;
+    }
+    for (int cell = 0; cell < cellCount; cell++) {
+        cellOffsets[cell + 1] += cellOffsets[cell];
+    }
+    cellCraters.resize(entries.size());
+    std::vector<int> cursor(cellOffsets.begin(), cellOffsets.end() - 1);
+    for (const auto& entry : entries) {
+        cellCraters[cursor[entry.first]++] = craters[entry.second];
+    }
+}
+
+float CraterNoiseFilter::CraterContribution(const glm::vec3& p, const glm::vec4& crater) const {
+    // Chord length is close enough to the angular distance at crater sizes
+    glm::vec3 offset = p - glm::vec3(crater);
+    float d2 = glm::dot(offset, offset);
+    float reach = crater.w * rimExtent;
+    if (d2 >= reach * reach) return 0.0f;
+    return CraterProfile(std::sqrt(d2) / crater.w) * crater.w * depthRatio;
+}
+
+float CraterNoiseFilter::Height(const glm::vec3& pointOnUnitSphere) const {
+    if (craters.empty()) return 0.0f;
+
+    // Cell on the finest level, the parents on coarser levels are found by shifting
+    glm::vec2 uv;
+    int face = CubeMap::FaceCoords(pointOnUnitSphere, uv);
+    int x = CubeMap::CoordToTexel(uv.x, 1 << maxLevel);
+    int y = CubeMap::CoordToTexel(uv.y, 1 << maxLevel);
+
+    float height = 0.0f;
+    for (int level = minLevel; level <= maxLevel; level++) {
+        int shift = maxLevel - level;
+        int resolution = 1 << level;
+        int cell = LevelStart(level) + (face * resolution + (y >> shift)) * resolution + (x >> shift);
+        for (int i = cellOffsets[cell]; i < cellOffsets[cell + 1]; i++) {
+            height += CraterContribution(pointOnUnitSphere, cellCraters[i]);
+        }
+    }
+    return height;
+}
+
+float CraterNoiseFilter::HeightBruteForce(const glm::vec3& pointOnUnitSphere) const {
+    float height = 0.0f;
+    for (const glm::vec4& crater : craters) {
+        height += CraterContribution(pointOnUnitSphere, crater);
+    }
+    return height;
+}
+
+float CraterNoiseFilter::Evaluate(const glm::vec3& point) const {
+    return Height(glm::normalize(point)) * settings.strength;
+}
@@ -0,0 +1,49 @@
+#pragma once
+#include <vector>
+#include "noiseFilter.h"
+#include "noiseLayer.h"
+#include "cubeMap.h"
+
+// Impact craters scattered over the sphere, with power-law distributed sizes.
+// The craters are stored in a quadtree on each cube face: every crater goes into the level whose
+// cells are about its size, in the handful of cells it overlaps there. A point then only looks at
+// the craters in its own cell on each level instead of all of them.
+// The same arrays are uploaded as buffer textures for craters.glsl.
+class CraterNoiseFilter : public NoiseFilter {
+public:
+    CraterNoiseFilter(const NoiseLayer& settings, float seed);
+    virtual float Evaluate(const glm::vec3& point) const override;
+
+    // Summed crater profiles at a point on the unit sphere (negative in the bowls, positive on the rims)
+    float Height(const glm::vec3& pointOnUnitSphere) const;
+    // Reference version testing every crater, for validating and benchmarking Height
+    float HeightBruteForce(const glm::vec3& pointOnUnitSphere) const;
+
+    // Quadtree levels that hold craters, level L has a 2^L x 2^L grid on each face
+    int GetMinLevel() const { return minLevel; }
+    int GetMaxLevel() const { return maxLevel; }
+    // Cells of all levels in one array, level L starts at LevelStart(L), then face by face, row by row
+    static int LevelStart(int level) { return CubeMap::faceCount * ((1 << (2 * level)) - 1) / 3; }
+    // xyz = crater center on the unit sphere, w = radius
+    const std::vector<glm::vec4>& GetCraters() const { return craters; }
+    // Craters of cell i are cellCraters[cellOffsets[i]] .. cellCraters[cellOffsets[i + 1] - 1].
+    // They are copies rather than indices into GetCraters, so a lookup reads one contiguous run.
+    const std::vector<int>& GetCellOffsets() const { return cellOffsets; }
+    const std::vector<glm::vec4>& GetCellCraters() const { return cellCraters; }
+
+    // How far the rim reaches, in crater radii
+    static constexpr float rimExtent = 1.5f;
+    static const int maxLevels = 10;
+
+private:
+    void Scatter(float seed);
+    void BuildIndex();
+    float CraterContribution(const glm::vec3& p, const glm::vec4& crater) const;
+
+    NoiseLayer settings;
+    int minLevel = 0;
+    int maxLevel = 0;
+    std::vector<glm::vec4> craters;
+    std::vector<int> cellOffsets;
+    std::vector<glm::vec4> cellCraters;
+};
@@ -0,0 +1,49 @@
+#pragma once
+#include <glm/glm.hpp>
+#include <cmath>
+
+// Face order and orientation of GL cube maps (GL_TEXTURE_CUBE_MAP_POSITIVE_X + face).
+// Everything that is stored per cube face uses this, so CPU data lines up with what the GPU samples.
+// cubeMap.glsl has the same mapping for the shaders.
+namespace CubeMap {
+    const int faceCount = 6;
+
+    // Face of a direction and its coordinates on that face, both in [-1, 1]
+    inline int FaceCoords(const glm::vec3& dir, glm::vec2& uv) {
+        glm::vec3 a = glm::abs(dir);
+        if (a.x >= a.y && a.x >= a.z) {
+            uv = dir.x > 0 ? glm::vec2(-dir.z, -dir.y) / a.x : glm::vec2(dir.z, -dir.y) / a.x;
+            return dir.x > 0 ? 0 : 1;
+        }
+        if (a.y >= a.z) {
+            uv = dir.y > 0 ? glm::vec2(dir.x, dir.z) / a.y : glm::vec2(dir.x, -dir.z) / a.y;
+            return dir.y > 0 ? 2 : 3;
+        }
+        uv = dir.z > 0 ? glm::vec2(dir.x, -dir.y) / a.z : glm::vec2(-dir.x, -dir.y) / a.z;
+        return dir.z > 0 ? 4 : 5;
+    }
+
+    // Point on the cube (not normalized) for face coordinates in [-1, 1].
+    // Coordinates outside that range continue on the face plane, which is handy for sampling across edges.
+    inline glm::vec3 Direction(int face, const glm::vec2& uv) {
+        switch (face) {
+        case 0: return glm::vec3(1.0f, -uv.y, -uv.x);
+        case 1: return glm::vec3(-1.0f, -uv.y, uv.x);
+        case 2: return glm::vec3(uv.x, 1.0f, uv.y);
+        case 3: return glm::vec3(uv.x, -1.0f, -uv.y);
+        case 4: return glm::vec3(uv.x, -uv.y, 1.0f);
+        default: return glm::vec3(-uv.x, -uv.y, -1.0f);
+        }
+    }
+
+    // Face coordinates of the center of a texel in a size x size face
+    inline glm::vec2 TexelCenter(int x, int y, int size) {
+        return glm::vec2((x + 0.5f) / size, (y + 0.5f) / size) * 2.0f - 1.0f;
+    }
+
+    // Texel (or grid cell) containing face coordinates, clamped to the face
+    inline int CoordToTexel(float coord, int size) {
+        int texel = static_cast<int>(std::floor((coord * 0.5f + 0.5f) * size));
+        return texel < 0 ? 0 : (texel >= size ? size - 1 : texel);
+    }
+}
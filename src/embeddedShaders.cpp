@@ -0,0 +1,10 @@
+#include "embeddedShaders.h"
+
+namespace EmbeddedShaders {
+    const EmbeddedShader* Find(std::string_view path) {
+        for (size_t i = 0; i < fileCount; i++) {
+            if (path == files[i].path) return &files[i];
+        }
+        return nullptr;
+    }
+}
@@ -0,0 +1,21 @@
+#pragma once
+#include <cstddef>
+#include <string_view>
+
+// A shader file compiled into the executable, under the path it has relative to the working directory
+struct EmbeddedShader {
+    const char* path;
+    const unsigned char* data;
+    size_t length;
+
+    std::string_view Text() const { return std::string_view(reinterpret_cast<const char*>(data), length); }
+};
+
+// Every file of shaders/, written into the build by cmake/EmbedShaders.cmake
+namespace EmbeddedShaders {
+    extern const EmbeddedShader files[];
+    extern const size_t fileCount;
+
+    // Null if there's no such file
+    const EmbeddedShader* Find(std::string_view path);
+}
@@ -1,5 +1,6 @@
 #include <glad/glad.h>
 #include <iostream>
+#include <algorithm>
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #include <filesystem>
@@ -8,6 +9,23 @@
 #include <imgui_impl_glfw.h>
 #include <imgui_impl_opengl3.h>
 #include "engine.h"
+#include "octaveLod.h"
+#include "textureUnits.h"
+#include "worleyNoiseFilter.h"
+#include "craterNoiseFilter.h"
+#include "plateNoiseFilter.h"
+#include "atmosphereLut.h"
+#include "renderTarget.h"
+#include "uniformBuffers.h"
+#include "parameterStore.h"
+#include "programCache.h"
+#include "cubeMap.h"
+#include "temporalHistory.h"
+#include "shaderReloader.h"
+#include "shaderPermutations.h"
+#include "shaderPreprocessor.h"
+#include "glState.h"
+#include "profiler.h"
 
 // FPS counter variables
 double lastFrameTime = 0.0;
@@ -46,18 +64,125 @@ bool firstPersonMode = false;
 ShapeSettings* shape = nullptr;
 float rotationSpeed = 0.0;
 float densityFalloff = 1.0;
+int opticalDepthMode = 1;
+bool multipleScattering = true;
 bool atmosphereEnabled = true;
+bool octaveLodEnabled = true;
+bool shaderPermutations = true;
+bool diskShaders = false;
 
 Shader* planetShader;
 Shader* atmosphereShader;
+
+// Shared uniform blocks, each uploaded once when its contents change instead of into every program
+UniformBuffer frameUniformBuffer;
+UniformBuffer atmosphereUniformBuffer;
+UniformBuffer noiseLayerUniformBuffer;
+NoiseLayersUniforms noiseLayerUniforms;
+// Values of the programs' own uniforms, set every frame but only uploaded to the programs when they change
+ParameterStore parameterStore;
+UniformUploadStats lastFrameUploads; // for the HUD
+StateChangeStats lastFrameStateChanges;
 glm::mat4 projection;
+glm::mat4 view;
+const float fieldOfView = 45.0f;
 
 glm::mat4 model;
 glm::vec3 lightPos(0.0, 100.0f, -600.0f);
 
 Sphere planet;
-Sphere atmosphere;
+// The planet is drawn here first, the atmosphere pass then reads its color and depth
+RenderTarget sceneTarget;
+// Atmosphere at reduced resolution, 1 << atmosphereResolution pixels across per texel
+RenderTarget atmosphereTarget;
+int atmosphereResolution = 1;
+Shader* atmosphereUpsampleShader;
+// Scattering of a quarter of the atmosphere pixels is redrawn each frame, the rest reprojected from the last ones
+bool temporalAtmosphere = true;
+TemporalHistory atmosphereHistory;
+// Sky-view LUT and aerial perspective froxels, redrawn every frame for the camera so the surface and the sky
+// read their scattering instead of each integrating nSamples steps of their own
+bool atmosphereViewLuts = true;
+RenderTarget skyViewTarget;
+VolumeTarget aerialPerspectiveTarget;
+Shader* skyViewShader;
+Shader* aerialPerspectiveShader;
+UniformHandle<int> aerialPerspectiveSlice; // set once per froxel slice every frame
+const int skyViewWidth = 192;
+const int skyViewHeight = 108;
+const int aerialPerspectiveSize = 32;
+GLuint fullscreenVao = 0;
+GLuint worleyTableTexture = 0;
+
+// Cloud layer between these fractions of the atmosphere thickness, marched through a baked noise volume
+bool cloudsEnabled = true;
+int cloudQuality = 1;
+float cloudCoverage = 0.5f;
+float cloudDensity = 20.0f;
+const float cloudBottom = 0.3f;
+const float cloudTop = 0.6f;
+const float cloudScale = 0.5f;
+const glm::vec3 cloudWind(0.01f, 0.0f, 0.005f);
+const int cloudNoiseSize = 128;
+// Cost of the cloud pass: a checkerboard half of the pixels of a target downsample times smaller is marched per frame
+struct CloudQuality {
+    int downsample;
+    int steps;
+    int lightSteps;
+};
+const CloudQuality cloudQualities[] = { { 4, 32, 3 }, { 2, 48, 4 }, { 2, 64, 6 }, { 1, 96, 8 } };
+Shader* cloudShader;
+Shader* cloudCompositeShader;
+TemporalHistory cloudHistory;
+VolumeTarget cloudNoiseTarget;
+
+// Humidity noise of planet.frag per point on the sphere, baked on the GPU whenever the seed changes
+Shader* humidityBakeShader;
+GLuint humidityMapTexture = 0;
+GLuint humidityFramebuffer = 0;
+float humidityMapSeed = 0.0f;
+bool hasHumidityMap = false;
+const int humidityMapResolution = 512;
+
+// Programs rebuilt when their files change on disk
+ShaderReloader shaderReloader;
+// Planet and atmosphere programs specialised for the current settings, and the layer part of the planet's defines
+ShaderPermutations* planetPermutations = nullptr;
+ShaderPermutations* atmospherePermutations = nullptr;
+Profiler profiler;
+bool showProfiler = false;
+std::string noiseLayerDefines;
+
+// Crater field of the first crater layer, and what it was built from so it's only rebuilt on change
+CraterNoiseFilter* craterField = nullptr;
+NoiseLayer craterFieldSettings;
+float craterFieldSeed = 0.0f;
+GLuint craterCellBuffer = 0, craterCellTexture = 0;
+GLuint craterOffsetBuffer = 0, craterOffsetTexture = 0;
+
+// Plates of the first plate layer, rebuilt only when the plate count or seed change
+PlateNoiseFilter* plateField = nullptr;
+int plateFieldCount = 0;
+float plateFieldSeed = 0.0f;
+const int plateCellResolution = 256;
+GLuint plateCellTexture = 0;
+GLuint plateDataBuffer = 0, plateDataTexture = 0;
+GLuint plateNeighbourBuffer = 0, plateNeighbourTexture = 0;
+
+ErosionSettings erosionSettings;
+ErosionJob erosionJob;
+GLuint heightmapTexture = 0;
+bool hasBakedHeightmap = false;
+bool useBakedHeightmap = false;
 float atmosphereThickness = 0.25;
+const float scaleDepth = 0.25f; // the average density is found 25% of the way from ground to atmosphere
+
+// Rebaked in the background whenever the radii or the density falloff change, these are the ones bound until then
+TransmittanceLut transmittanceLut;
+MultiScatteringLut multiScatteringLut;
+AtmosphereLutJob atmosphereLutJob;
+GLuint transmittanceLutTexture = 0;
+GLuint multiScatteringLutTexture = 0;
 
 float wavelengths[3];
 float invWavelength4[3];
@@ -74,6 +199,7 @@ const float exposure = 2.0f;
 
 const float scatterStrength = 20;
 void Init(GLFWwindow* window) {
+    double initStart = glfwGetTime();
     // Initialize last frame time
     lastFrameTime = glfwGetTime();
 
@@ -84,9 +210,9 @@ void Init(GLFWwindow* window) {
     invWavelength4[1] = powf(400/wavelengths[1], 4.0f) * scatterStrength;
     invWavelength4[2] = powf(400/wavelengths[2], 4.0f) * scatterStrength;
     // Enable depth testing
-    glEnable(GL_DEPTH_TEST);
-    glEnable(GL_CULL_FACE);
-    glDepthFunc(GL_LEQUAL);
+    GLState::Enable(GL_DEPTH_TEST);
+    GLState::Enable(GL_CULL_FACE);
+    GLState::DepthFunc(GL_LEQUAL);
 
     glfwSetCursorPosCallback(window, MouseCallback);
     glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
@@ -96,10 +222,75 @@ void Init(GLFWwindow* window) {
 
 
     // Load shader
+    ShaderPreprocessor::Shared().SetReadFromDisk(diskShaders);
+    frameUniformBuffer.Create(UNIFORM_BINDING_FRAME, sizeof(FrameUniforms));
+    atmosphereUniformBuffer.Create(UNIFORM_BINDING_ATMOSPHERE, sizeof(AtmosphereUniforms));
+    noiseLayerUniformBuffer.Create(UNIFORM_BINDING_NOISE_LAYERS, sizeof(NoiseLayersUniforms));
+
     planetShader = new Shader("shaders/planet.vert", "shaders/planet.frag", "shaders/planet.geom" );
     planetShader->enable();
-    planetShader->setVec3("lightColor", lightColor);
     planetShader->setFloat("maxElevation", atmosphereThickness);
+    planetShader->setInt("worleyTable", TEXTURE_UNIT_WORLEY_TABLE);
+
+    glGenTextures(1, &worleyTableTexture);
+    glActiveTexture(GL_TEXTURE0 + TEXTURE_UNIT_WORLEY_TABLE);
+    glBindTexture(GL_TEXTURE_2D, worleyTableTexture);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glActiveTexture(GL_TEXTURE0);
+
+    planetShader->setInt("craterCells", TEXTURE_UNIT_CRATER_CELLS);
+    planetShader->setInt("craterCellOffsets", TEXTURE_UNIT_CRATER_CELL_OFFSETS);
+    glGenBuffers(1, &craterCellBuffer);
+    glGenBuffers(1, &craterOffsetBuffer);
+    glGenTextures(1, &craterCellTexture);
+    glGenTextures(1, &craterOffsetTexture);
+
+    planetShader->setInt("plateCells", TEXTURE_UNIT_PLATE_CELLS);
+    planetShader->setInt("plateData", TEXTURE_UNIT_PLATE_DATA);
+    glGenTextures(1, &plateCellTexture);
+    glActiveTexture(GL_TEXTURE0 + TEXTURE_UNIT_PLATE_CELLS);
+    glBindTexture(GL_TEXTURE_CUBE_MAP, plateCellTexture);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glActiveTexture(GL_TEXTURE0);
+    planetShader->setInt("plateNeighbours", TEXTURE_UNIT_PLATE_NEIGHBOURS);
+    glGenBuffers(1, &plateDataBuffer);
+    glGenTextures(1, &plateDataTexture);
+    glGenBuffers(1, &plateNeighbourBuffer);
+    glGenTextures(1, &plateNeighbourTexture);
+
+    planetShader->setInt("heightmap", TEXTURE_UNIT_HEIGHTMAP);
+    glGenTextures(1, &heightmapTexture);
+    glActiveTexture(GL_TEXTURE0 + TEXTURE_UNIT_HEIGHTMAP);
+    glBindTexture(GL_TEXTURE_CUBE_MAP, heightmapTexture);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glEnable(GL_TEXTURE_CUBE_MAP_SEAMLESS);
+    glActiveTexture(GL_TEXTURE0);
+
+    planetShader->setInt("transmittanceLut", TEXTURE_UNIT_TRANSMITTANCE_LUT);
+    planetShader->setInt("multiScatteringLut", TEXTURE_UNIT_MULTI_SCATTERING_LUT);
+    planetShader->setInt("aerialPerspective", TEXTURE_UNIT_AERIAL_PERSPECTIVE);
+    glGenTextures(1, &transmittanceLutTexture);
+    glActiveTexture(GL_TEXTURE0 + TEXTURE_UNIT_TRANSMITTANCE_LUT);
+    glBindTexture(GL_TEXTURE_2D, transmittanceLutTexture);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glGenTextures(1, &multiScatteringLutTexture);
+    glActiveTexture(GL_TEXTURE0 + TEXTURE_UNIT_MULTI_SCATTERING_LUT);
+    glBindTexture(GL_TEXTURE_2D, multiScatteringLutTexture);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glActiveTexture(GL_TEXTURE0);
 
 
     shape = new ShapeSettings(4.0f, 50);
@@ -111,11 +302,97 @@ void Init(GLFWwindow* window) {
 
 
     atmosphereShader = new Shader("shaders/atmosphere.vert", "shaders/atmosphere.frag");
-
-    atmosphere.Create(shape->radius * (1.0 + atmosphereThickness), shape->resolution);
+    atmosphereShader->enable();
+    atmosphereShader->setInt("transmittanceLut", TEXTURE_UNIT_TRANSMITTANCE_LUT);
+    atmosphereShader->setInt("multiScatteringLut", TEXTURE_UNIT_MULTI_SCATTERING_LUT);
+    atmosphereShader->setInt("sceneColor", TEXTURE_UNIT_SCENE_COLOR);
+    atmosphereShader->setInt("sceneDepth", TEXTURE_UNIT_SCENE_DEPTH);
+    atmosphereShader->setInt("skyViewLut", TEXTURE_UNIT_SKY_VIEW_LUT);
+    atmosphereShader->setInt("aerialPerspective", TEXTURE_UNIT_AERIAL_PERSPECTIVE);
+    atmosphereShader->setInt("history", TEXTURE_UNIT_ATMOSPHERE_HISTORY);
+    atmosphereShader->disable();
+    atmosphereUpsampleShader = new Shader("shaders/atmosphere.vert", "shaders/atmosphereUpsample.frag");
+    atmosphereUpsampleShader->enable();
+    atmosphereUpsampleShader->setInt("sceneColor", TEXTURE_UNIT_SCENE_COLOR);
+    atmosphereUpsampleShader->setInt("sceneDepth", TEXTURE_UNIT_SCENE_DEPTH);
+    atmosphereUpsampleShader->setInt("atmosphereColor", TEXTURE_UNIT_ATMOSPHERE);
+    atmosphereUpsampleShader->disable();
+
+    skyViewShader = new Shader("shaders/atmosphere.vert", "shaders/skyViewLut.frag");
+    skyViewShader->enable();
+    skyViewShader->setInt("transmittanceLut", TEXTURE_UNIT_TRANSMITTANCE_LUT);
+    skyViewShader->setInt("multiScatteringLut", TEXTURE_UNIT_MULTI_SCATTERING_LUT);
+    skyViewShader->setInt("skyViewLut", TEXTURE_UNIT_SKY_VIEW_LUT);
+    skyViewShader->setVec2("lutSize", glm::vec2(skyViewWidth, skyViewHeight));
+    skyViewShader->disable();
+    skyViewTarget.Resize(skyViewWidth, skyViewHeight);
+    glActiveTexture(GL_TEXTURE0 + TEXTURE_UNIT_SKY_VIEW_LUT);
+    glBindTexture(GL_TEXTURE_2D, skyViewTarget.GetColorTexture());
+    glActiveTexture(GL_TEXTURE0);
+
+    aerialPerspectiveShader = new Shader("shaders/atmosphere.vert", "shaders/aerialPerspectiveLut.frag");
+    aerialPerspectiveShader->enable();
+    aerialPerspectiveShader->setInt("transmittanceLut", TEXTURE_UNIT_TRANSMITTANCE_LUT);
+    aerialPerspectiveShader->setInt("multiScatteringLut", TEXTURE_UNIT_MULTI_SCATTERING_LUT);
+    aerialPerspectiveShader->setInt("sceneDepth", TEXTURE_UNIT_SCENE_DEPTH);
+    aerialPerspectiveShader->setInt("aerialPerspective", TEXTURE_UNIT_AERIAL_PERSPECTIVE);
+    aerialPerspectiveShader->setFloat("lutSize", static_cast<float>(aerialPerspectiveSize));
+    aerialPerspectiveShader->disable();
+    aerialPerspectiveSlice = UniformHandle<int>(*aerialPerspectiveShader, "slice");
+    aerialPerspectiveTarget.Resize(aerialPerspectiveSize, aerialPerspectiveSize, aerialPerspectiveSize);
+    glActiveTexture(GL_TEXTURE0 + TEXTURE_UNIT_AERIAL_PERSPECTIVE);
+    glBindTexture(GL_TEXTURE_3D, aerialPerspectiveTarget.GetTexture());
+    glActiveTexture(GL_TEXTURE0);
+
+    cloudShader = new Shader("shaders/atmosphere.vert", "shaders/clouds.frag");
+    cloudShader->enable();
+    cloudShader->setInt("transmittanceLut", TEXTURE_UNIT_TRANSMITTANCE_LUT);
+    cloudShader->setInt("multiScatteringLut", TEXTURE_UNIT_MULTI_SCATTERING_LUT);
+    cloudShader->setInt("sceneDepth", TEXTURE_UNIT_SCENE_DEPTH);
+    cloudShader->setInt("history", TEXTURE_UNIT_CLOUD_HISTORY);
+    cloudShader->setInt("cloudNoise", TEXTURE_UNIT_CLOUD_NOISE);
+    cloudShader->disable();
+    cloudCompositeShader = new Shader("shaders/atmosphere.vert", "shaders/cloudComposite.frag");
+    cloudCompositeShader->enable();
+    cloudCompositeShader->setInt("clouds", TEXTURE_UNIT_CLOUDS);
+    cloudCompositeShader->disable();
+
+    humidityBakeShader = new Shader("shaders/atmosphere.vert", "shaders/humidityBake.frag");
+    planetShader->enable();
+    planetShader->setInt("humidityMap", TEXTURE_UNIT_HUMIDITY_MAP);
+    planetShader->disable();
+    glGenTextures(1, &humidityMapTexture);
+    glActiveTexture(GL_TEXTURE0 + TEXTURE_UNIT_HUMIDITY_MAP);
+    glBindTexture(GL_TEXTURE_CUBE_MAP, humidityMapTexture);
+    for (int face = 0; face < CubeMap::faceCount; face++) {
+        glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + face, 0, GL_R16F, humidityMapResolution, humidityMapResolution, 0,
+            GL_RED, GL_FLOAT, nullptr);
+    }
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glActiveTexture(GL_TEXTURE0);
+    glGenFramebuffers(1, &humidityFramebuffer);
+
+    // Core profile won't draw without a vertex array, even one with no attributes
+    glGenVertexArrays(1, &fullscreenVao);
     SetNoiseLayers(shape->noiseLayers);
+    BakeCloudNoise();
+
+    shaderReloader.Init((GLADloadproc)glfwGetProcAddress, diskShaders);
+    for (Shader* shader : { planetShader, atmosphereShader, atmosphereUpsampleShader, skyViewShader, aerialPerspectiveShader,
+        cloudShader, cloudCompositeShader, humidityBakeShader }) {
+        shaderReloader.Watch(shader);
+    }
+    planetPermutations = new ShaderPermutations(planetShader, shaderReloader);
+    atmospherePermutations = new ShaderPermutations(atmosphereShader, shaderReloader);
 
     rotation = glm::mat4(1.0f);
+
+    // Cold launches compile every program, warm ones load them from the program cache
+    std::cout << "Init took " << (glfwGetTime() - initStart) * 1000.0 << " ms, " << ProgramCache::GetHits()
+        << " programs from the cache, " << ProgramCache::GetMisses() << " compiled" << std::endl;
 }
 
 void UpdateFPS() {
@@ -147,8 +424,8 @@ void UpdateFPS() {
 
 void RenderFPSCounter() {
     // Set up ImGui window in the top-right corner with FPS display
-    ImGui::SetNextWindowPos(ImVec2(ImGui::GetIO().DisplaySize.x - 150, 10), ImGuiCond_FirstUseEver);
-    ImGui::SetNextWindowSize(ImVec2(140, 70), ImGuiCond_FirstUseEver);
+    ImGui::SetNextWindowPos(ImVec2(ImGui::GetIO().DisplaySize.x - 230, 10), ImGuiCond_FirstUseEver);
+    ImGui::SetNextWindowSize(ImVec2(220, 120), ImGuiCond_FirstUseEver);
     
     // Create a small overlay window with minimal decorations
     ImGuiWindowFlags window_flags = ImGuiWindowFlags_NoDecoration | 
@@ -160,28 +437,53 @@ void RenderFPSCounter() {
     ImGui::Begin("FPS Counter", nullptr, window_flags);
     ImGui::Text("FPS: %.1f", averageFps);
     ImGui::Text("Frame Time: %.2f ms", frameTime * 1000.0);
+    ImGui::Text("Uniforms: %d set, %d skipped", lastFrameUploads.uniforms, lastFrameUploads.skipped);
+    ImGui::Text("Blocks: %d (%d bytes)", lastFrameUploads.blocks, lastFrameUploads.blockBytes);
+    ImGui::Text("State: %d set, %d skipped", lastFrameStateChanges.issued, lastFrameStateChanges.elided);
     ImGui::End();
 }
 
 void RenderLoop(GLFWwindow* window) {
     while (!glfwWindowShouldClose(window)) {
-
+        profiler.BeginFrame();
 
         // Set viewport and projection matrix
         int width, height;
         glfwGetFramebufferSize(window, &width, &height);
         float aspect = static_cast<float>(width) / static_cast<float>(height);
-        projection = glm::perspective(glm::radians(45.0f), aspect, 0.1f, 100.0f);
+        projection = glm::perspective(glm::radians(fieldOfView), aspect, 0.1f, 100.0f);
         model = glm::mat4(1.0f);
-        glViewport(0, 0, width, height);
+        // Minimized windows have no framebuffer, keep the target valid anyway
+        sceneTarget.Resize(std::max(width, 1), std::max(height, 1));
+        sceneTarget.Bind();
 
         // Update FPS at the start of each frame
         UpdateFPS();
+        lastFrameUploads = uniformUploadStats;
+        uniformUploadStats = UniformUploadStats();
+        lastFrameStateChanges = stateChangeStats;
+        stateChangeStats = StateChangeStats();
 
         GLenum err;
         while ((err = glGetError()) != GL_NO_ERROR) {
             std::cerr << "OpenGL error: " << err << std::endl;
         }
+
+        // Programs whose edited files finished compiling; what they drew before no longer matches
+        for (Shader* shader : shaderReloader.Update()) {
+            // A relinked program can place its uniforms elsewhere
+            if (shader == aerialPerspectiveShader)
+                aerialPerspectiveSlice = UniformHandle<int>(*aerialPerspectiveShader, "slice");
+            if (shader == humidityBakeShader) {
+                hasHumidityMap = false;
+                BakeHumidityMap(humidityMapSeed);
+                sceneTarget.Bind();
+            }
+            atmosphereHistory.Invalidate();
+            cloudHistory.Invalidate();
+        }
+        planetPermutations->Update();
+        atmospherePermutations->Update();
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
         planetShader->enable();
@@ -208,102 +510,117 @@ void RenderLoop(GLFWwindow* window) {
             std::cout << forward.x << " " << forward.y << " " << forward.z << std::endl;
         }
         glm::vec3 front = cameraBasis * glm::normalize(cameraFront);
-        glm::mat4 view = glm::lookAt(cameraPos, cameraPos + front, cameraUp);
+        view = glm::lookAt(cameraPos, cameraPos + front, cameraUp);
 
         model = rotation * model;
-        planetShader->setMat4("model", model);
-        planetShader->setMat4("view", view);
-        planetShader->setMat4("projection", projection);
-
-        planetShader->setVec3("lightPos", lightPos);
-
-        planetShader->setInt("nSamples", nSamples);
-        planetShader->setVec3("cameraPos", cameraPos);
-        planetShader->setVec3("lightPos", lightPos);
-        planetShader->setVec3("lightColor", lightColor);
-        planetShader->setVec3("invWavelength4", invWavelength4[0], invWavelength4[1], invWavelength4[2]);
+        profiler.BeginCpu("Uniforms");
+        parameterStore.Set("model", model);
+        parameterStore.Set("view", view);
+        parameterStore.Set("projection", projection);
+        parameterStore.Set("inverseViewProjection", glm::inverse(projection * view));
+        parameterStore.Set("viewportSize", glm::vec2(sceneTarget.GetWidth(), sceneTarget.GetHeight()));
+        UpdateScatteringUniforms();
+        profiler.EndCpu();
+
+        profiler.BeginCpu("Regeneration");
         float cameraHeight = glm::length(cameraPos - glm::vec3(0, 0, 0));
-        planetShader->setFloat("cameraHeight", cameraHeight);
-        planetShader->setFloat("cameraHeight2", cameraHeight * cameraHeight);
-        float atmosphereRadius = shape->radius * (1.0 + atmosphereThickness);
-        planetShader->setFloat("atmosphereRadius", atmosphereRadius);
-        planetShader->setFloat("atmosphereRadius2", atmosphereRadius * atmosphereRadius);
-        float planetRadius = shape->radius;
-        planetShader->setFloat("planetRadius", planetRadius);
-        planetShader->setFloat("planetRadius2", planetRadius * planetRadius);
-
-        planetShader->setFloat("kRayleighSunBrightness", kRayleigh * sunBrightness);
-        planetShader->setFloat("kMieSunBrightness", kMie * sunBrightness);
-        float scale = 1 / (atmosphereRadius - planetRadius);
-        planetShader->setFloat("scale", scale);
-        planetShader->setFloat("scaleDepth", 0.25); // the average density is found 25% of the way from ground to atmosphere
-        
-        planetShader->setFloat("gMie", gMie);
-        planetShader->setFloat("gMie2", gMie * gMie);
-
-        planetShader->setFloat("densityFalloff", densityFalloff);
-
-        planetShader->setFloat("exposure", exposure);
+        UpdateOctaveLod(cameraHeight, height);
+        UpdateAtmosphereLuts();
+        UploadFinishedErosion();
+        parameterStore.Set("useBakedHeightmap", useBakedHeightmap && hasBakedHeightmap);
+        profiler.EndCpu();
+
+        // The planet reads this frame's froxels, they're drawn first and the planet's target and shader set back up
+        profiler.BeginGpu("Atmosphere views");
+        UpdateAtmosphereViews();
+        profiler.EndGpu();
+        sceneTarget.Bind();
+        std::string scatteringDefines = shaderPermutations ? ScatteringDefines() : "";
+        Shader* planetProgram = shaderPermutations ? planetPermutations->Get(noiseLayerDefines + scatteringDefines) : planetShader;
+        profiler.BeginGpu("Planet");
+        planetProgram->enable();
+        planetProgram->Upload(parameterStore);
+        // Full-screen passes turn the depth test off and leave it that way
+        GLState::Enable(GL_DEPTH_TEST);
         // Draw mesh
         planet.Draw();
 
-        planetShader->disable();
+        planetProgram->disable();
+        profiler.EndGpu();
+
+        profiler.BeginGpu("Clouds");
+        if (cloudsEnabled) RenderClouds();
+        else cloudHistory.Invalidate();
+        profiler.EndGpu();
 
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        glViewport(0, 0, width, height);
+        profiler.BeginGpu("Atmosphere");
         if (atmosphereEnabled)
         {
-
-
-
-            atmosphereShader->enable();
-
-            atmosphereShader->setMat4("model", model);
-            atmosphereShader->setMat4("view", view);
-            atmosphereShader->setMat4("projection", projection);
-			atmosphereShader->setInt("nSamples", nSamples);
-            atmosphereShader->setVec3("cameraPos", cameraPos);
-            atmosphereShader->setVec3("lightPos", lightPos);
-			atmosphereShader->setVec3("lightColor", lightColor);
-            atmosphereShader->setVec3("invWavelength4", invWavelength4[0], invWavelength4[1], invWavelength4[2]);
-            float cameraHeight = glm::length(cameraPos - glm::vec3(0, 0, 0));
-            atmosphereShader->setFloat("cameraHeight", cameraHeight);
-            atmosphereShader->setFloat("cameraHeight2", cameraHeight * cameraHeight);
-            float atmosphereRadius = shape->radius * (1.0 + atmosphereThickness);
-            atmosphereShader->setFloat("atmosphereRadius", atmosphereRadius);
-            atmosphereShader->setFloat("atmosphereRadius2", atmosphereRadius * atmosphereRadius);
-            float planetRadius = shape->radius;
-            atmosphereShader->setFloat("planetRadius", planetRadius);
-            atmosphereShader->setFloat("planetRadius2", planetRadius * planetRadius);
-
-            atmosphereShader->setFloat("kRayleighSunBrightness", kRayleigh * sunBrightness);
-            atmosphereShader->setFloat("kMieSunBrightness", kMie * sunBrightness);
-            float scale = 1 / (atmosphereRadius - planetRadius);
-            atmosphereShader->setFloat("scale", scale);
-			atmosphereShader->setFloat("scaleDepth", 0.25); // the average density is found 25% of the way from ground to atmosphere
-			std::cout << "gMie: " << gMie << std::endl;
-            atmosphereShader->setFloat("gMie", gMie);
-            atmosphereShader->setFloat("gMie2", gMie * gMie);
-
-            atmosphereShader->setFloat("densityFalloff", densityFalloff);
-
-            atmosphereShader->setFloat("exposure", exposure);
-
-            glEnable(GL_BLEND);
-            glBlendFunc(GL_ONE, GL_ONE);
-            glFrontFace(GL_CW);
-            glDepthMask(GL_FALSE);
-            // 1. Draw back faces of the atmosphere sphere
-            glCullFace(GL_FRONT); // Cull the front faces, so only back faces are drawn
-            atmosphere.Draw();
-
-            // 2. Draw front faces of the atmosphere sphere
-            glCullFace(GL_BACK); // Cull the back faces, so only front faces are drawn
-            atmosphere.Draw();
-            glDepthMask(GL_TRUE);
-            glFrontFace(GL_CCW);
-            glDisable(GL_BLEND);
-
-            atmosphereShader->disable();
+            Shader* atmosphereProgram = shaderPermutations ? atmospherePermutations->Get(scatteringDefines) : atmosphereShader;
+            atmosphereProgram->enable();
+
+            // One pass over the screen, scattering integrated per pixel up to the planet's depth
+            glActiveTexture(GL_TEXTURE0 + TEXTURE_UNIT_SCENE_COLOR);
+            glBindTexture(GL_TEXTURE_2D, sceneTarget.GetColorTexture());
+            glActiveTexture(GL_TEXTURE0 + TEXTURE_UNIT_SCENE_DEPTH);
+            glBindTexture(GL_TEXTURE_2D, sceneTarget.GetDepthTexture());
+            glActiveTexture(GL_TEXTURE0);
+            GLState::Disable(GL_DEPTH_TEST);
+            GLState::BindVertexArray(fullscreenVao);
+
+            // At reduced resolution or with temporal reuse the scattering goes into its own target first
+            // and gets upsampled over the scene
+            int downsample = 1 << atmosphereResolution;
+            int atmosphereWidth = std::max(width / downsample, 1);
+            int atmosphereHeight = std::max(height / downsample, 1);
+            bool reduced = downsample > 1 || temporalAtmosphere;
+            RenderTarget* target = &atmosphereTarget;
+            parameterStore.Set("writeDistance", reduced);
+            parameterStore.Set("temporal", temporalAtmosphere);
+            atmosphereProgram->Upload(parameterStore);
+            if (temporalAtmosphere) {
+                atmosphereHistory.TrackInputs({
+                    shape->radius, atmosphereThickness, densityFalloff, gMie,
+                    invWavelength4[0], invWavelength4[1], invWavelength4[2],
+                    lightPos.x, lightPos.y, lightPos.z, lightColor.x, lightColor.y, lightColor.z,
+                    static_cast<float>(opticalDepthMode), static_cast<float>(multipleScattering),
+                    static_cast<float>(atmosphereViewLuts),
+                });
+                atmosphereHistory.Resize(atmosphereWidth, atmosphereHeight);
+                atmosphereHistory.BeginFrame(projection * view, model, cameraPos);
+                atmosphereHistory.Bind(atmosphereProgram, TEXTURE_UNIT_ATMOSPHERE_HISTORY);
+                target = &atmosphereHistory.Current();
+            } else {
+                atmosphereHistory.Invalidate();
+                if (reduced) atmosphereTarget.Resize(atmosphereWidth, atmosphereHeight);
+            }
+            if (reduced) target->Bind();
+            glDrawArrays(GL_TRIANGLES, 0, 3);
+            atmosphereProgram->disable();
+
+            if (reduced) {
+                glBindFramebuffer(GL_FRAMEBUFFER, 0);
+                glViewport(0, 0, width, height);
+                atmosphereUpsampleShader->enable();
+                atmosphereUpsampleShader->Upload(parameterStore);
+                glActiveTexture(GL_TEXTURE0 + TEXTURE_UNIT_ATMOSPHERE);
+                glBindTexture(GL_TEXTURE_2D, target->GetColorTexture());
+                glActiveTexture(GL_TEXTURE0);
+                glDrawArrays(GL_TRIANGLES, 0, 3);
+                atmosphereUpsampleShader->disable();
+            }
+            if (temporalAtmosphere) atmosphereHistory.EndFrame();
+        }
+        else
+        {
+            atmosphereHistory.Invalidate();
+            glBindFramebuffer(GL_READ_FRAMEBUFFER, sceneTarget.GetFramebuffer());
+            glBlitFramebuffer(0, 0, width, height, 0, 0, width, height, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+            glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
         }
+        profiler.EndGpu();
         // Start the Dear ImGui frame
         ImGui_ImplOpenGL3_NewFrame();
         ImGui_ImplGlfw_NewFrame();
@@ -311,43 +628,466 @@ void RenderLoop(GLFWwindow* window) {
 
         // Display the FPS counter
         RenderFPSCounter();
+        if (showProfiler) profiler.DrawWindow(&showProfiler);
 
         PlanetUI::DrawMainControls(shape, [&]() {
+            ProfileZone zone(profiler, "Regeneration");
             SetNoiseLayers(shape->noiseLayers);
         });
 
         ImGuiIO& io = ImGui::GetIO();
 
+        profiler.BeginCpu("Input");
         ProcessInput(window);
+        profiler.EndCpu();
         
         ImGui::Render();
+        profiler.BeginGpu("ImGui");
         ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+        profiler.EndGpu();
         
+        profiler.BeginCpu("Swap");
         glfwSwapBuffers(window);
+        profiler.EndCpu();
+        profiler.BeginCpu("Input");
         glfwPollEvents();
+        profiler.EndCpu();
+        profiler.EndFrame();
 
     }
 }
 
 void SetNoiseLayers(const std::vector<NoiseLayer*> layers) {
-    planetShader->enable();
+    // A heightmap baked from the old layers would hide the edit, bake again to erode the new terrain
+    erosionJob.Cancel();
+    hasBakedHeightmap = false;
+    parameterStore.Set("seed", shape->seed);
+    noiseLayerDefines = NoiseLayerDefines(layers);
+
+    int layerCount = std::min(static_cast<int>(layers.size()), maxNoiseLayers);
+    noiseLayerUniforms.layerCount = layerCount;
+    for (int i = 0; i < layerCount; i++) {
+        const NoiseLayer* layer = layers[i];
+        NoiseLayerUniforms& uniforms = noiseLayerUniforms.layers[i];
+        uniforms.enabled = layer->enabled;
+        uniforms.strength = layer->strength;
+        uniforms.baseRoughness = layer->baseRoughness;
+        uniforms.roughness = layer->roughness;
+        uniforms.persistence = layer->persistence;
+        uniforms.octaves = layer->octaves;
+        uniforms.visibleOctaves = (float)layer->octaves;
+        uniforms.minValue = layer->minValue;
+        uniforms.center = layer->center;
+        uniforms.type = static_cast<int>(layer->type);
+        uniforms.worleyOutput = static_cast<int>(layer->worleyOutput);
+    }
+    noiseLayerUniformBuffer.Update(noiseLayerUniforms);
 
-    planetShader->setFloat("seed", shape->seed);
+    UploadWorleyTable(shape->seed);
+    UploadCraterField(layers, shape->seed);
+    UploadPlateField(layers, shape->seed);
+    BakeHumidityMap(shape->seed);
+}
 
-    for (int i = 0; i < layers.size() && i < 8; i++) {
+std::string NoiseLayerDefines(const std::vector<NoiseLayer*>& layers) {
+    std::string defines = "#define NOISE_LAYERS";
+    for (int i = 0; i < layers.size() && i < maxNoiseLayers; i++) {
         const NoiseLayer* layer = layers[i];
-        std::string base = "noiseLayers[" + std::to_string(i) + "]";
-        planetShader->setBool(base + ".enabled", layer->enabled);
-        planetShader->setFloat(base + ".strength", layer->strength);
-        planetShader->setInt(base + ".octaves", layer->octaves);
-        planetShader->setFloat(base + ".baseRoughness", layer->baseRoughness);
-        planetShader->setFloat(base + ".roughness", layer->roughness);
-        planetShader->setFloat(base + ".persistence", layer->persistence);
-        planetShader->setVec3(base + ".center", layer->center);
-        planetShader->setFloat(base + ".minValue", layer->minValue);
+        if (!layer->enabled) continue;
+        defines += " NOISE_LAYER(" + std::to_string(i) + ", " + std::to_string(static_cast<int>(layer->type)) + ", " +
+            std::to_string(layer->octaves) + ")";
     }
-    planetShader->setInt("layerCount", layers.size());
-    planetShader->disable();
+    return defines + "\n";
+}
+
+std::string ScatteringDefines() {
+    return "#define SCATTERING_SAMPLES " + std::to_string(nSamples) + "\n" +
+        "#define OPTICAL_DEPTH_MODE " + std::to_string(opticalDepthMode) + "\n" +
+        "#define MULTIPLE_SCATTERING " + (multipleScattering ? "true" : "false") + "\n";
+}
+
+// The noise volume only depends on its size, it's baked once. Wraps around so it tiles.
+void BakeCloudNoise() {
+    Shader bakeShader("shaders/atmosphere.vert", "shaders/cloudNoise.frag");
+    cloudNoiseTarget.Resize(cloudNoiseSize, cloudNoiseSize, cloudNoiseSize);
+    glActiveTexture(GL_TEXTURE0 + TEXTURE_UNIT_CLOUD_NOISE);
+    glBindTexture(GL_TEXTURE_3D, cloudNoiseTarget.GetTexture());
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_R, GL_REPEAT);
+    glActiveTexture(GL_TEXTURE0);
+
+    bakeShader.enable();
+    bakeShader.setFloat("volumeSize", static_cast<float>(cloudNoiseSize));
+    GLState::Disable(GL_DEPTH_TEST);
+    GLState::BindVertexArray(fullscreenVao);
+    UniformHandle<int> sliceUniform(bakeShader, "slice");
+    for (int slice = 0; slice < cloudNoiseSize; slice++) {
+        cloudNoiseTarget.BindSlice(slice);
+        sliceUniform.Set(slice);
+        glDrawArrays(GL_TRIANGLES, 0, 3);
+    }
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    bakeShader.disable();
+}
+
+// Clouds go over the scene before the atmosphere, which then treats them like the surface behind them
+void RenderClouds() {
+    const CloudQuality& quality = cloudQualities[cloudQuality];
+    float planetRadius = shape->radius;
+    float thickness = planetRadius * atmosphereThickness;
+    glm::mat4 viewProjection = projection * view;
+
+    cloudHistory.TrackInputs({
+        planetRadius, atmosphereThickness, cloudCoverage, cloudDensity, static_cast<float>(cloudQuality),
+        invWavelength4[0], invWavelength4[1], invWavelength4[2],
+        lightPos.x, lightPos.y, lightPos.z, lightColor.x, lightColor.y, lightColor.z,
+        static_cast<float>(opticalDepthMode),
+    });
+    cloudHistory.Resize(std::max(sceneTarget.GetWidth() / quality.downsample, 1),
+        std::max(sceneTarget.GetHeight() / quality.downsample, 1));
+    cloudHistory.BeginFrame(viewProjection, model, cameraPos);
+
+    parameterStore.Set("cloudBottom", planetRadius + thickness * cloudBottom);
+    parameterStore.Set("cloudTop", planetRadius + thickness * cloudTop);
+    parameterStore.Set("cloudCoverage", cloudCoverage);
+    parameterStore.Set("cloudDensity", cloudDensity);
+    parameterStore.Set("cloudScale", cloudScale);
+    parameterStore.Set("cloudOffset", cloudWind * static_cast<float>(glfwGetTime()));
+    parameterStore.Set("cloudSteps", quality.steps);
+    parameterStore.Set("cloudLightSteps", quality.lightSteps);
+    cloudShader->enable();
+    cloudShader->Upload(parameterStore);
+    cloudHistory.Bind(cloudShader, TEXTURE_UNIT_CLOUD_HISTORY);
+    glActiveTexture(GL_TEXTURE0 + TEXTURE_UNIT_SCENE_DEPTH);
+    glBindTexture(GL_TEXTURE_2D, sceneTarget.GetDepthTexture());
+    glActiveTexture(GL_TEXTURE0);
+    GLState::Disable(GL_DEPTH_TEST);
+    GLState::BindVertexArray(fullscreenVao);
+    cloudHistory.Current().Bind();
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+    cloudShader->disable();
+
+    // Upsampled bilinearly, clouds are soft enough
+    sceneTarget.Bind();
+    cloudCompositeShader->enable();
+    glActiveTexture(GL_TEXTURE0 + TEXTURE_UNIT_CLOUDS);
+    glBindTexture(GL_TEXTURE_2D, cloudHistory.Current().GetColorTexture());
+    glActiveTexture(GL_TEXTURE0);
+    GLState::Enable(GL_BLEND);
+    GLState::BlendFunc(GL_ONE, GL_SRC_ALPHA);
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+    GLState::Disable(GL_BLEND);
+    cloudCompositeShader->disable();
+    cloudHistory.EndFrame();
+}
+
+// Humidity only depends on the seed and the point on the sphere, so planet.frag reads it from a cube map
+// instead of running 4 octaves of noise per pixel
+void BakeHumidityMap(float seed) {
+    if (hasHumidityMap && humidityMapSeed == seed) return;
+    humidityMapSeed = seed;
+    hasHumidityMap = true;
+
+    humidityBakeShader->enable();
+    humidityBakeShader->setFloat("seed", seed);
+    humidityBakeShader->setFloat("faceSize", static_cast<float>(humidityMapResolution));
+    glBindFramebuffer(GL_FRAMEBUFFER, humidityFramebuffer);
+    glViewport(0, 0, humidityMapResolution, humidityMapResolution);
+    GLState::Disable(GL_DEPTH_TEST);
+    GLState::BindVertexArray(fullscreenVao);
+    for (int face = 0; face < CubeMap::faceCount; face++) {
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_CUBE_MAP_POSITIVE_X + face, humidityMapTexture, 0);
+        humidityBakeShader->setInt("face", face);
+        glDrawArrays(GL_TRIANGLES, 0, 3);
+    }
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    humidityBakeShader->disable();
+}
+
+// Feature point table for worley.glsl, rebuilt whenever the seed changes
+void UploadWorleyTable(float seed) {
+    WorleyFeatureTable table;
+    table.Build(seed);
+
+    std::vector<glm::vec4> texels(WorleyFeatureTable::size);
+    for (int i = 0; i < WorleyFeatureTable::size; i++) {
+        texels[i] = glm::vec4(table.points[i], static_cast<float>(table.perm[i]));
+    }
+
+    glActiveTexture(GL_TEXTURE0 + TEXTURE_UNIT_WORLEY_TABLE);
+    glBindTexture(GL_TEXTURE_2D, worleyTableTexture);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA32F, WorleyFeatureTable::size, 1, 0, GL_RGBA, GL_FLOAT, texels.data());
+    glActiveTexture(GL_TEXTURE0);
+}
+
+// Drop the noise octaves that are too fine to show up from the current camera distance
+void UpdateOctaveLod(float cameraHeight, int viewportHeight) {
+    const std::vector<NoiseLayer*>& layers = shape->noiseLayers;
+    for (int i = 0; i < layers.size() && i < maxNoiseLayers; i++) {
+        const NoiseLayer* layer = layers[i];
+        float visibleOctaves = (float)layer->octaves;
+        if (octaveLodEnabled) {
+            visibleOctaves = ComputeVisibleOctaves(*layer, shape->radius, cameraHeight, shape->resolution,
+                glm::radians(fieldOfView), viewportHeight);
+        }
+        noiseLayerUniforms.layers[i].visibleOctaves = visibleOctaves;
+    }
+    noiseLayerUniformBuffer.Update(noiseLayerUniforms);
+}
+
+// Only the first crater layer gets a crater field on the GPU
+void UploadCraterField(const std::vector<NoiseLayer*>& layers, float seed) {
+    int craterLayer = -1;
+    for (int i = 0; i < layers.size() && i < maxNoiseLayers; i++) {
+        if (layers[i]->enabled && layers[i]->type == NoiseType::Craters) {
+            craterLayer = i;
+            break;
+        }
+    }
+
+    parameterStore.Set("craterLayer", craterLayer);
+    if (craterLayer < 0) {
+        parameterStore.Set("craterMinLevel", 1);
+        parameterStore.Set("craterMaxLevel", 0);
+        return;
+    }
+
+    // Scattering and indexing a million craters takes a while, so skip it unless the field changed
+    const NoiseLayer& layer = *layers[craterLayer];
+    bool changed = craterField == nullptr || craterFieldSeed != seed
+        || craterFieldSettings.featureCount != layer.featureCount
+        || craterFieldSettings.minFeatureSize != layer.minFeatureSize
+        || craterFieldSettings.maxFeatureSize != layer.maxFeatureSize
+        || craterFieldSettings.sizeExponent != layer.sizeExponent;
+    if (changed) {
+        delete craterField;
+        craterField = new CraterNoiseFilter(layer, seed);
+        craterFieldSettings = layer;
+        craterFieldSeed = seed;
+
+        const std::vector<glm::vec4>& cells = craterField->GetCellCraters();
+        const std::vector<int>& offsets = craterField->GetCellOffsets();
+
+        glBindBuffer(GL_TEXTURE_BUFFER, craterCellBuffer);
+        glBufferData(GL_TEXTURE_BUFFER, cells.size() * sizeof(glm::vec4), cells.data(), GL_STATIC_DRAW);
+        glBindBuffer(GL_TEXTURE_BUFFER, craterOffsetBuffer);
+        glBufferData(GL_TEXTURE_BUFFER, offsets.size() * sizeof(int), offsets.data(), GL_STATIC_DRAW);
+        glBindBuffer(GL_TEXTURE_BUFFER, 0);
+
+        glActiveTexture(GL_TEXTURE0 + TEXTURE_UNIT_CRATER_CELLS);
+        glBindTexture(GL_TEXTURE_BUFFER, craterCellTexture);
+        glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, craterCellBuffer);
+        glActiveTexture(GL_TEXTURE0 + TEXTURE_UNIT_CRATER_CELL_OFFSETS);
+        glBindTexture(GL_TEXTURE_BUFFER, craterOffsetTexture);
+        glTexBuffer(GL_TEXTURE_BUFFER, GL_R32I, craterOffsetBuffer);
+        glActiveTexture(GL_TEXTURE0);
+    }
+
+    parameterStore.Set("craterMinLevel", craterField->GetMinLevel());
+    parameterStore.Set("craterMaxLevel", craterField->GetCraters().empty() ? -1 : craterField->GetMaxLevel());
+}
+
+// Bakes the current layers into a heightmap and erodes it on the thread pool
+void StartErosion() {
+    std::vector<NoiseLayer> layers;
+    for (const NoiseLayer* layer : shape->noiseLayers) {
+        layers.push_back(*layer);
+    }
+    erosionJob.Start(layers, shape->seed, erosionSettings);
+}
+
+// Picks up the eroded heightmap once the job is done; the previous one stays in use until then
+void UploadFinishedErosion() {
+    CubeHeightmap heightmap;
+    if (!erosionJob.TakeResult(heightmap)) return;
+
+    const size_t faceTexels = static_cast<size_t>(heightmap.size) * heightmap.size;
+    glActiveTexture(GL_TEXTURE0 + TEXTURE_UNIT_HEIGHTMAP);
+    glBindTexture(GL_TEXTURE_CUBE_MAP, heightmapTexture);
+    for (int face = 0; face < CubeMap::faceCount; face++) {
+        glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + face, 0, GL_R32F, heightmap.size, heightmap.size, 0,
+            GL_RED, GL_FLOAT, heightmap.texels.data() + face * faceTexels);
+    }
+    glActiveTexture(GL_TEXTURE0);
+
+    hasBakedHeightmap = true;
+    useBakedHeightmap = true;
+}
+
+// Only the first plate layer gets plates on the GPU
+void UploadPlateField(const std::vector<NoiseLayer*>& layers, float seed) {
+    int plateLayer = -1;
+    for (int i = 0; i < layers.size() && i < maxNoiseLayers; i++) {
+        if (layers[i]->enabled && layers[i]->type == NoiseType::Plates) {
+            plateLayer = i;
+            break;
+        }
+    }
+
+    parameterStore.Set("plateLayer", plateLayer);
+    if (plateLayer < 0) return;
+
+    // The border width only changes the shading, the cells depend on the count and seed
+    const NoiseLayer& layer = *layers[plateLayer];
+    if (plateField == nullptr || plateFieldSeed != seed || plateFieldCount != layer.featureCount) {
+        delete plateField;
+        plateField = new PlateNoiseFilter(layer, seed);
+        plateFieldCount = layer.featureCount;
+        plateFieldSeed = seed;
+
+        // Plate k's neighbours are plateNeighbours[offset k .. offset k+1), the offsets ride along in
+        // the rotation texel and one extra pair at the end holds the last one
+        const std::vector<TectonicPlate>& plates = plateField->GetPlates();
+        const std::vector<int>& offsets = plateField->GetTriangulation().GetNeighbourOffsets();
+        const std::vector<int>& neighbours = plateField->GetTriangulation().GetNeighbours();
+        std::vector<glm::vec4> data;
+        for (size_t i = 0; i <= plates.size(); i++) {
+            TectonicPlate plate = i < plates.size() ? plates[i] : TectonicPlate{};
+            data.push_back(glm::vec4(plate.site, plate.height));
+            data.push_back(glm::vec4(plate.rotation, i < offsets.size() ? static_cast<float>(offsets[i]) : 0.0f));
+        }
+        glBindBuffer(GL_TEXTURE_BUFFER, plateDataBuffer);
+        glBufferData(GL_TEXTURE_BUFFER, data.size() * sizeof(glm::vec4), data.data(), GL_STATIC_DRAW);
+        glBindBuffer(GL_TEXTURE_BUFFER, plateNeighbourBuffer);
+        // Never empty, a zero sized buffer store isn't allowed
+        glBufferData(GL_TEXTURE_BUFFER, std::max<size_t>(neighbours.size(), 1) * sizeof(int), neighbours.data(), GL_STATIC_DRAW);
+        glBindBuffer(GL_TEXTURE_BUFFER, 0);
+        glActiveTexture(GL_TEXTURE0 + TEXTURE_UNIT_PLATE_DATA);
+        glBindTexture(GL_TEXTURE_BUFFER, plateDataTexture);
+        glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, plateDataBuffer);
+        glActiveTexture(GL_TEXTURE0 + TEXTURE_UNIT_PLATE_NEIGHBOURS);
+        glBindTexture(GL_TEXTURE_BUFFER, plateNeighbourTexture);
+        glTexBuffer(GL_TEXTURE_BUFFER, GL_R32I, plateNeighbourBuffer);
+
+        std::vector<int> cells = plateField->BakeCells(plateCellResolution);
+        const size_t faceTexels = static_cast<size_t>(plateCellResolution) * plateCellResolution;
+        glActiveTexture(GL_TEXTURE0 + TEXTURE_UNIT_PLATE_CELLS);
+        glBindTexture(GL_TEXTURE_CUBE_MAP, plateCellTexture);
+        for (int face = 0; face < CubeMap::faceCount; face++) {
+            glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + face, 0, GL_R32I, plateCellResolution, plateCellResolution, 0,
+                GL_RED_INTEGER, GL_INT, cells.data() + face * faceTexels);
+        }
+        glActiveTexture(GL_TEXTURE0);
+    }
+    parameterStore.Set("plateSoftness", PlateNoiseFilter::Softness(layer.maxFeatureSize, layer.featureCount));
+}
+
+// Rebakes the atmosphere LUTs when the radii or the density falloff changed, only while they're in use.
+// Multiple scattering is baked from the transmittance LUT, so that one is kept up to date for either.
+void UpdateAtmosphereLuts() {
+    if (opticalDepthMode == 1 || multipleScattering) {
+        AtmosphereParams params;
+        params.planetRadius = shape->radius;
+        params.atmosphereRadius = shape->radius * (1.0f + atmosphereThickness);
+        params.densityFalloff = densityFalloff;
+        params.scaleDepth = scaleDepth;
+        atmosphereLutJob.Start(params, glm::vec3(invWavelength4[0], invWavelength4[1], invWavelength4[2]));
+        // With nothing to show yet the first bake is waited for, later ones land a few frames after a slider moves
+        if (transmittanceLut.texels.empty()) atmosphereLutJob.Wait();
+    }
+    if (!atmosphereLutJob.TakeResult(transmittanceLut, multiScatteringLut)) return;
+    atmosphereHistory.Invalidate();
+
+    glActiveTexture(GL_TEXTURE0 + TEXTURE_UNIT_TRANSMITTANCE_LUT);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_R32F, TransmittanceLut::width, TransmittanceLut::height, 0,
+        GL_RED, GL_FLOAT, transmittanceLut.texels.data());
+    glActiveTexture(GL_TEXTURE0 + TEXTURE_UNIT_MULTI_SCATTERING_LUT);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB32F, MultiScatteringLut::size, MultiScatteringLut::size, 0,
+        GL_RGB, GL_FLOAT, multiScatteringLut.texels.data());
+    glActiveTexture(GL_TEXTURE0);
+}
+
+void UpdateScatteringUniforms() {
+    float cameraHeight = glm::length(cameraPos);
+    float planetRadius = shape->radius;
+    float atmosphereRadius = planetRadius * (1.0f + atmosphereThickness);
+
+    FrameUniforms frame = {};
+    frame.cameraPos = cameraPos;
+    frame.cameraHeight = cameraHeight;
+    frame.lightPos = lightPos;
+    frame.cameraHeight2 = cameraHeight * cameraHeight;
+    frame.lightColor = lightColor;
+    // From outside the atmosphere it covers too little of the sky-view LUT, the sky is integrated per pixel then
+    frame.useSkyViewLut = atmosphereViewLuts && cameraHeight < atmosphereRadius;
+    frame.useAerialPerspective = atmosphereViewLuts;
+    // Froxel slices from the nearest point of the atmosphere to the furthest one not behind the horizon
+    float horizonDistance = std::sqrt(std::max(cameraHeight * cameraHeight - planetRadius * planetRadius, 0.0f));
+    frame.aerialPerspectiveNear = std::max(cameraHeight - atmosphereRadius, 0.0f);
+    frame.aerialPerspectiveFar = horizonDistance + std::sqrt(atmosphereRadius * atmosphereRadius - planetRadius * planetRadius);
+    frameUniformBuffer.Update(frame);
+
+    AtmosphereUniforms atmosphere = {};
+    atmosphere.invWavelength4 = glm::vec3(invWavelength4[0], invWavelength4[1], invWavelength4[2]);
+    atmosphere.atmosphereRadius = atmosphereRadius;
+    atmosphere.atmosphereRadius2 = atmosphereRadius * atmosphereRadius;
+    atmosphere.planetRadius = planetRadius;
+    atmosphere.planetRadius2 = planetRadius * planetRadius;
+    atmosphere.kRayleighSunBrightness = kRayleigh * sunBrightness;
+    atmosphere.kMieSunBrightness = kMie * sunBrightness;
+    atmosphere.scale = 1 / (atmosphereRadius - planetRadius);
+    atmosphere.scaleDepth = scaleDepth;
+    atmosphere.densityFalloff = densityFalloff;
+    atmosphere.gMie = gMie;
+    atmosphere.gMie2 = gMie * gMie;
+    atmosphere.exposure = exposure;
+    atmosphere.nSamples = nSamples;
+    atmosphere.opticalDepthMode = opticalDepthMode;
+    atmosphere.multipleScattering = multipleScattering;
+    atmosphereUniformBuffer.Update(atmosphere);
+}
+
+ScatteringSettings CurrentScatteringSettings() {
+    ScatteringSettings settings;
+    settings.params.planetRadius = shape->radius;
+    settings.params.atmosphereRadius = shape->radius * (1.0f + atmosphereThickness);
+    settings.params.densityFalloff = densityFalloff;
+    settings.params.scaleDepth = scaleDepth;
+    settings.cameraPos = cameraPos;
+    settings.lightPos = lightPos;
+    settings.lightColor = lightColor;
+    settings.invWavelength4 = glm::vec3(invWavelength4[0], invWavelength4[1], invWavelength4[2]);
+    settings.kRayleighSunBrightness = kRayleigh * sunBrightness;
+    settings.kMieSunBrightness = kMie * sunBrightness;
+    settings.gMie = gMie;
+    settings.exposure = exposure;
+    settings.samples = nSamples;
+    settings.opticalDepthMode = opticalDepthMode;
+    // The LUTs are only baked when something reads them
+    bool lutsBaked = !transmittanceLut.texels.empty() && transmittanceLut.params == settings.params;
+    settings.transmittance = lutsBaked ? &transmittanceLut : nullptr;
+    settings.multiScattering = lutsBaked && multipleScattering ? &multiScatteringLut : nullptr;
+    return settings;
+}
+
+bool RenderReferenceSky(const std::string& path, int width, int height) {
+    std::vector<glm::vec3> pixels = RenderScattering(CurrentScatteringSettings(), glm::inverse(projection * view), width, height);
+    return WritePpm(path, pixels, width, height);
+}
+
+void UpdateAtmosphereViews() {
+    if (!atmosphereViewLuts) return;
+    GLState::Disable(GL_DEPTH_TEST);
+    GLState::BindVertexArray(fullscreenVao);
+
+    if (glm::length(cameraPos) < shape->radius * (1.0f + atmosphereThickness)) {
+        skyViewShader->enable();
+        skyViewTarget.Bind();
+        glDrawArrays(GL_TRIANGLES, 0, 3);
+        skyViewShader->disable();
+    }
+
+    aerialPerspectiveShader->enable();
+    aerialPerspectiveShader->Upload(parameterStore);
+    for (int slice = 0; slice < aerialPerspectiveSize; slice++) {
+        aerialPerspectiveTarget.BindSlice(slice);
+        aerialPerspectiveSlice.Set(slice);
+        glDrawArrays(GL_TRIANGLES, 0, 3);
+    }
+    aerialPerspectiveShader->disable();
+
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
 }
 
 void ProcessInput(GLFWwindow* window) {
@@ -459,8 +1199,50 @@ void MouseCallback(GLFWwindow* window, double xpos, double ypos) {
 }
 
 void Cleanup() {
+    delete planetPermutations;
+    delete atmospherePermutations;
+    shaderReloader.Destroy();
+    profiler.Destroy();
+    erosionJob.Cancel();
+    atmosphereLutJob.Cancel();
     planet.Destroy();
+    sceneTarget.Destroy();
+    frameUniformBuffer.Destroy();
+    atmosphereUniformBuffer.Destroy();
+    noiseLayerUniformBuffer.Destroy();
+    atmosphereTarget.Destroy();
+    atmosphereHistory.Destroy();
+    cloudHistory.Destroy();
+    cloudNoiseTarget.Destroy();
+    skyViewTarget.Destroy();
+    aerialPerspectiveTarget.Destroy();
+    GLState::DeleteVertexArray(fullscreenVao);
+    glDeleteTextures(1, &heightmapTexture);
+    glDeleteTextures(1, &humidityMapTexture);
+    glDeleteFramebuffers(1, &humidityFramebuffer);
+    glDeleteTextures(1, &worleyTableTexture);
+    glDeleteTextures(1, &craterCellTexture);
+    glDeleteTextures(1, &craterOffsetTexture);
+    glDeleteBuffers(1, &craterCellBuffer);
+    glDeleteBuffers(1, &craterOffsetBuffer);
+    delete craterField;
+    glDeleteTextures(1, &plateCellTexture);
+    glDeleteTextures(1, &plateDataTexture);
+    glDeleteTextures(1, &plateNeighbourTexture);
+    glDeleteBuffers(1, &plateDataBuffer);
+    glDeleteBuffers(1, &plateNeighbourBuffer);
+    delete plateField;
+    plateField = nullptr;
+    glDeleteTextures(1, &transmittanceLutTexture);
+    glDeleteTextures(1, &multiScatteringLutTexture);
     delete planetShader;
+    delete atmosphereShader;
+    delete atmosphereUpsampleShader;
+    delete humidityBakeShader;
+    delete cloudShader;
+    delete cloudCompositeShader;
+    delete skyViewShader;
+    delete aerialPerspectiveShader;
     delete shape;
     std::cout << "Cleanup done.\n";
 }
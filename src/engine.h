@@ -8,6 +8,7 @@
 #include "globals.h"
 #include "planetUI.h"
 #include "sphere.h"
+#include "scatteringReference.h"
 
 // FPS counter variables
 extern double lastFrameTime;
@@ -20,6 +21,28 @@ void RenderLoop(GLFWwindow* window);
 void ProcessInput(GLFWwindow* window);
 void Cleanup();
 void SetNoiseLayers(const std::vector<NoiseLayer*> layers);
+// #defines that make the enabled layers, their types and octave counts constants in planet.vert
+std::string NoiseLayerDefines(const std::vector<NoiseLayer*>& layers);
+// #defines that make the sample count and the optical depth and multiple scattering switches constants in scattering.glsl
+std::string ScatteringDefines();
+void UpdateOctaveLod(float cameraHeight, int viewportHeight);
+void UploadWorleyTable(float seed);
+void UploadCraterField(const std::vector<NoiseLayer*>& layers, float seed);
+void UploadPlateField(const std::vector<NoiseLayer*>& layers, float seed);
+void BakeHumidityMap(float seed);
+void BakeCloudNoise();
+void RenderClouds();
+void UpdateAtmosphereLuts();
+// Fills the frame and atmosphere uniform blocks everything scattering.glsl and the LUTs read, once per frame
+void UpdateScatteringUniforms();
+// Redraws the sky-view LUT and the aerial perspective froxels for the camera, leaves the default framebuffer bound
+void UpdateAtmosphereViews();
+// What the scattering uniforms hold, for the CPU reference
+ScatteringSettings CurrentScatteringSettings();
+// The current view of the atmosphere through the CPU reference, written as a PPM
+bool RenderReferenceSky(const std::string& path, int width, int height);
+void StartErosion();
+void UploadFinishedErosion();
 void MouseCallback(GLFWwindow* window, double xpos, double ypos);
 void UpdateFPS();
 void RenderFPSCounter();
\ No newline at end of file
@@ -0,0 +1,270 @@
+#include "erosion.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <random>
+#include "threadPool.h"
+
+namespace {
+    // Droplets are simulated on tiles of a face plus a halo around them, copied out of the heightmap.
+    // Tiles run in parallel on their own copy and their changes are added back in a fixed order,
+    // so the halos are how neighbouring tiles (and faces) see each other's work between batches.
+    const int tileSize = 64;
+    const int tileHalo = 16;
+    const int tilesPerBatch = 64; // fixed rather than per thread, so the result doesn't depend on the thread count
+
+    struct Tile {
+        int face, x0, y0;
+    };
+
+    struct TileScratch {
+        std::vector<int> texels;      // heightmap index of every tile texel
+        std::vector<float> heights;
+        std::vector<float> original;
+    };
+
+    struct HeightSample {
+        float height;
+        glm::vec2 gradient;
+    };
+
+    // Elevation is relative to the radius, a texel is about (pi / 2) / size of it
+    float TexelHeightScale(int size) {
+        return size / 1.5707963f;
+    }
+
+    void ScaleHeights(CubeHeightmap& heightmap, float factor) {
+        for (float& h : heightmap.texels) h *= factor;
+    }
+
+    uint32_t TileSeed(float seed, int pass, int tile) {
+        uint32_t h;
+        std::memcpy(&h, &seed, sizeof(h));
+        h ^= static_cast<uint32_t>(pass) * 0x9E3779B9u;
+        h = (h ^ (h >> 16)) * 0x85EBCA6Bu;
+        h ^= static_cast<uint32_t>(tile) * 0xC2B2AE35u;
+        h = (h ^ (h >> 13)) * 0x7FEB352Du;
+        return h ^ (h >> 16);
+    }
+
+    HeightSample SampleHeight(const std::vector<float>& heights, int span, const glm::vec2& pos) {
+        int x = static_cast<int>(pos.x), y = static_cast<int>(pos.y);
+        float u = pos.x - x, v = pos.y - y;
+        int i = y * span + x;
+        float h00 = heights[i], h10 = heights[i + 1];
+        float h01 = heights[i + span], h11 = heights[i + span + 1];
+
+        HeightSample sample;
+        sample.height = h00 * (1 - u) * (1 - v) + h10 * u * (1 - v) + h01 * (1 - u) * v + h11 * u * v;
+        sample.gradient = glm::vec2((h10 - h00) * (1 - v) + (h11 - h01) * v, (h01 - h00) * (1 - u) + (h11 - h10) * u);
+        return sample;
+    }
+
+    // Adds amount (negative to erode) spread bilinearly over the 4 texels around pos
+    void AddHeight(std::vector<float>& heights, int span, const glm::vec2& pos, float amount) {
+        int x = static_cast<int>(pos.x), y = static_cast<int>(pos.y);
+        float u = pos.x - x, v = pos.y - y;
+        int i = y * span + x;
+        heights[i] += amount * (1 - u) * (1 - v);
+        heights[i + 1] += amount * u * (1 - v);
+        heights[i + span] += amount * (1 - u) * v;
+        heights[i + span + 1] += amount * u * v;
+    }
+
+    void SimulateDroplets(std::vector<float>& heights, int tile, int count, std::mt19937& rng, const ErosionSettings& s) {
+        const int span = tile + 2 * tileHalo;
+        const float limit = static_cast<float>(span - 1);
+        std::uniform_real_distribution<float> start(static_cast<float>(tileHalo), static_cast<float>(tileHalo + tile));
+
+        for (int d = 0; d < count; d++) {
+            glm::vec2 pos(start(rng), start(rng));
+            glm::vec2 dir(0.0f);
+            float speed = 1.0f, water = 1.0f, sediment = 0.0f;
+
+            for (int step = 0; step < s.maxLifetime; step++) {
+                HeightSample here = SampleHeight(heights, span, pos);
+                dir = dir * s.inertia - here.gradient * (1.0f - s.inertia);
+                float length = glm::length(dir);
+                if (length < 1e-6f) {
+                    AddHeight(heights, span, pos, sediment); // stuck in a flat pit
+                    break;
+                }
+                dir /= length;
+
+                // Droplets that run off the tile's halo are dropped, the neighbouring tile covers that ground
+                glm::vec2 next = pos + dir;
+                if (next.x < 0.0f || next.y < 0.0f || next.x >= limit || next.y >= limit) break;
+
+                float deltaHeight = SampleHeight(heights, span, next).height - here.height;
+                float carry = std::max(-deltaHeight * speed * water * s.capacity, s.minCapacity);
+                if (sediment > carry || deltaHeight > 0.0f) {
+                    // Going uphill fills the hole behind it, otherwise drop what it can't carry
+                    float amount = deltaHeight > 0.0f ? std::min(deltaHeight, sediment) : (sediment - carry) * s.depositionRate;
+                    sediment -= amount;
+                    AddHeight(heights, span, pos, amount);
+                }
+                else {
+                    // Never dig deeper than the step down, that would leave pits
+                    float amount = std::min((carry - sediment) * s.erosionRate, -deltaHeight);
+                    sediment += amount;
+                    AddHeight(heights, span, pos, -amount);
+                }
+
+                speed = std::sqrt(std::max(0.0f, speed * speed - deltaHeight * s.gravity));
+                water *= 1.0f - s.evaporation;
+                pos = next;
+            }
+        }
+    }
+}
+
+bool ErodeHydraulic(CubeHeightmap& heightmap, const ErosionSettings& settings, float seed,
+    const std::function<void(float)>& onProgress, const std::atomic<bool>* cancel) {
+    const int size = heightmap.size;
+    const int tile = std::min(tileSize, size);
+    const int span = tile + 2 * tileHalo;
+    const int tilesPerSide = (size + tile - 1) / tile;
+    const int passes = std::max(settings.passes, 1);
+    const int dropletsPerTile = std::max(1, static_cast<int>(settings.dropletsPerTexel * tile * tile / passes + 0.5f));
+
+    std::vector<Tile> tiles;
+    for (int face = 0; face < CubeMap::faceCount; face++) {
+        for (int ty = 0; ty < tilesPerSide; ty++) {
+            for (int tx = 0; tx < tilesPerSide; tx++) {
+                tiles.push_back({ face, tx * tile, ty * tile });
+            }
+        }
+    }
+
+    const float heightScale = TexelHeightScale(size);
+    ScaleHeights(heightmap, heightScale);
+
+    std::vector<TileScratch> scratch(tilesPerBatch);
+    const int batchCount = (static_cast<int>(tiles.size()) + tilesPerBatch - 1) / tilesPerBatch;
+    for (int pass = 0; pass < passes; pass++) {
+        for (int batch = 0; batch < batchCount; batch++) {
+            if (cancel && *cancel) break;
+            const int first = batch * tilesPerBatch;
+            const int count = std::min(tilesPerBatch, static_cast<int>(tiles.size()) - first);
+
+            ThreadPool::Shared().ParallelFor(count, [&](int b) {
+                const Tile& t = tiles[first + b];
+                TileScratch& s = scratch[b];
+                s.texels.resize(span * span);
+                s.heights.resize(span * span);
+                for (int y = 0; y < span; y++) {
+                    for (int x = 0; x < span; x++) {
+                        int i = y * span + x;
+                        // Past the face edge this picks up the neighbouring face
+                        s.texels[i] = heightmap.WrappedIndex(t.face, t.x0 + x - tileHalo, t.y0 + y - tileHalo);
+                        s.heights[i] = heightmap.texels[s.texels[i]];
+                    }
+                }
+                s.original = s.heights;
+
+                std::mt19937 rng(TileSeed(seed, pass, first + b));
+                SimulateDroplets(s.heights, tile, dropletsPerTile, rng, settings);
+            });
+
+            // Add the changes back in tile order, tiles overlapping through their halos both count
+            for (int b = 0; b < count; b++) {
+                const TileScratch& s = scratch[b];
+                for (size_t i = 0; i < s.texels.size(); i++) {
+                    float delta = s.heights[i] - s.original[i];
+                    if (delta != 0.0f) heightmap.texels[s.texels[i]] += delta;
+                }
+            }
+            if (onProgress) onProgress(static_cast<float>(pass * batchCount + batch + 1) / (passes * batchCount));
+        }
+    }
+
+    ScaleHeights(heightmap, 1.0f / heightScale);
+    return !(cancel && *cancel);
+}
+
+bool ErodeThermal(CubeHeightmap& heightmap, const ErosionSettings& settings,
+    const std::function<void(float)>& onProgress, const std::atomic<bool>* cancel) {
+    const int size = heightmap.size;
+    const float heightScale = TexelHeightScale(size);
+    ScaleHeights(heightmap, heightScale);
+
+    // Every texel works out its own exchange with its 4 neighbours from the previous iteration,
+    // both sides of a pair see the same height difference so material is moved, not created
+    std::vector<float> next(heightmap.texels.size());
+    const float share = settings.thermalRate * 0.5f;
+    for (int iteration = 0; iteration < settings.thermalIterations; iteration++) {
+        if (cancel && *cancel) break;
+        ThreadPool::Shared().ParallelFor(CubeMap::faceCount * size, [&](int row) {
+            int face = row / size, y = row % size;
+            for (int x = 0; x < size; x++) {
+                int i = heightmap.Index(face, x, y);
+                float h = heightmap.texels[i];
+                float result = h;
+                const int neighbours[4] = {
+                    heightmap.WrappedIndex(face, x - 1, y), heightmap.WrappedIndex(face, x + 1, y),
+                    heightmap.WrappedIndex(face, x, y - 1), heightmap.WrappedIndex(face, x, y + 1),
+                };
+                for (int n : neighbours) {
+                    float difference = h - heightmap.texels[n];
+                    if (difference > settings.talusSlope) result -= share * (difference - settings.talusSlope);
+                    else if (-difference > settings.talusSlope) result += share * (-difference - settings.talusSlope);
+                }
+                next[i] = result;
+            }
+        });
+        heightmap.texels.swap(next);
+        if (onProgress) onProgress(static_cast<float>(iteration + 1) / settings.thermalIterations);
+    }
+
+    ScaleHeights(heightmap, 1.0f / heightScale);
+    return !(cancel && *cancel);
+}
+
+ErosionJob::~ErosionJob() {
+    Cancel();
+}
+
+void ErosionJob::Start(const std::vector<NoiseLayer>& layers, float seed, const ErosionSettings& settings) {
+    Cancel();
+    cancel = false;
+    progress = 0.0f;
+
+    // Runs on the pool itself, the ParallelFor calls inside it pitch in rather than block a worker
+    task = ThreadPool::Shared().Submit([this, layers, seed, settings]() {
+        CubeHeightmap heightmap;
+        heightmap.Resize(settings.resolution);
+        if (!BakeHeightmap(layers, seed, heightmap, &cancel)) return false;
+        progress = 0.1f;
+        if (!ErodeHydraulic(heightmap, settings, seed, [this](float f) { progress = 0.1f + 0.8f * f; }, &cancel)) return false;
+        if (!ErodeThermal(heightmap, settings, [this](float f) { progress = 0.9f + 0.1f * f; }, &cancel)) return false;
+        result = std::move(heightmap);
+        progress = 1.0f;
+        return true;
+    });
+}
+
+void ErosionJob::Cancel() {
+    if (!task.valid()) return;
+    cancel = true;
+    task.wait();
+    task = std::future<bool>();
+    result = CubeHeightmap();
+}
+
+bool ErosionJob::IsRunning() const {
+    return task.valid() && task.wait_for(std::chrono::seconds(0)) != std::future_status::ready;
+}
+
+bool ErosionJob::IsFinished() const {
+    return task.valid() && task.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+}
+
+bool ErosionJob::TakeResult(CubeHeightmap& heightmap) {
+    if (!IsFinished()) return false;
+    bool completed = task.get();
+    if (!completed) return false;
+    heightmap = std::move(result);
+    result = CubeHeightmap();
+    return true;
+}
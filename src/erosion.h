@@ -0,0 +1,57 @@
+#pragma once
+#include <atomic>
+#include <functional>
+#include <future>
+#include <vector>
+#include "heightmap.h"
+
+struct ErosionSettings {
+    int resolution = 512;          // heightmap texels per cube face (multiple of the tile size)
+
+    // Hydraulic: water droplets running downhill, picking up sediment and dropping it where they slow down
+    float dropletsPerTexel = 1.0f;
+    int passes = 8;                // droplets are split over this many passes, tiles are merged in between
+    int maxLifetime = 48;          // steps before a droplet gives up
+    float inertia = 0.05f;         // how much a droplet keeps its direction instead of following the slope
+    float capacity = 4.0f;         // sediment a droplet can carry per unit of speed, water and slope
+    float minCapacity = 0.01f;
+    float erosionRate = 0.3f;
+    float depositionRate = 0.3f;
+    float evaporation = 0.02f;
+    float gravity = 4.0f;
+
+    // Thermal: material slides off slopes steeper than the talus angle
+    int thermalIterations = 20;
+    float talusSlope = 0.8f;       // rise over run
+    float thermalRate = 0.25f;
+};
+
+// Both run in place over the thread pool and return false if cancel was raised.
+// Heights are handled in texel units while they run so slopes are geometric, not resolution dependent.
+// The result only depends on the seed and settings, not on the number of threads.
+bool ErodeHydraulic(CubeHeightmap& heightmap, const ErosionSettings& settings, float seed,
+    const std::function<void(float)>& onProgress, const std::atomic<bool>* cancel);
+bool ErodeThermal(CubeHeightmap& heightmap, const ErosionSettings& settings,
+    const std::function<void(float)>& onProgress, const std::atomic<bool>* cancel);
+
+// Bakes the noise layers into a heightmap and erodes it in the background
+class ErosionJob {
+public:
+    ~ErosionJob();
+
+    // Cancels a running job and starts over with the given layers
+    void Start(const std::vector<NoiseLayer>& layers, float seed, const ErosionSettings& settings);
+    void Cancel();
+    bool IsRunning() const;
+    // A result is waiting in TakeResult
+    bool IsFinished() const;
+    float GetProgress() const { return progress; }
+    // Moves the finished heightmap out; false if there is none (still running, cancelled or never started)
+    bool TakeResult(CubeHeightmap& heightmap);
+
+private:
+    std::future<bool> task;
+    std::atomic<bool> cancel{ false };
+    std::atomic<float> progress{ 0.0f };
+    CubeHeightmap result;
+};
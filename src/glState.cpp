@@ -0,0 +1,93 @@
+#include "glState.h"
+
+namespace {
+    // -1 until set through here
+    struct Cached {
+        GLint value = -1;
+        GLint second = -1;
+
+        // True if the driver call is needed
+        bool Set(GLint v, GLint w = 0) {
+            if (value == v && second == w) {
+                stateChangeStats.elided++;
+                return false;
+            }
+            value = v;
+            second = w;
+            stateChangeStats.issued++;
+            return true;
+        }
+    };
+
+    Cached program, vertexArray, blend, cullFace, depthTest, blendFunc, depthFunc, depthMask, cullFaceMode, frontFace;
+
+    Cached* Capability(GLenum capability) {
+        switch (capability) {
+        case GL_BLEND: return &blend;
+        case GL_CULL_FACE: return &cullFace;
+        case GL_DEPTH_TEST: return &depthTest;
+        default: return nullptr;
+        }
+    }
+}
+
+namespace GLState {
+    void UseProgram(GLuint id) {
+        if (program.Set(static_cast<GLint>(id))) glUseProgram(id);
+    }
+
+    GLuint GetProgram() {
+        if (program.value < 0) {
+            GLint current = 0;
+            glGetIntegerv(GL_CURRENT_PROGRAM, &current);
+            program.value = current;
+            program.second = 0;
+        }
+        return static_cast<GLuint>(program.value);
+    }
+
+    void BindVertexArray(GLuint id) {
+        if (vertexArray.Set(static_cast<GLint>(id))) glBindVertexArray(id);
+    }
+
+    void DeleteVertexArray(GLuint id) {
+        if (vertexArray.value == static_cast<GLint>(id)) vertexArray = Cached{ 0, 0 };
+        glDeleteVertexArrays(1, &id);
+    }
+
+    void Enable(GLenum capability) {
+        Cached* cached = Capability(capability);
+        if (cached == nullptr) stateChangeStats.issued++;
+        if (cached == nullptr || cached->Set(GL_TRUE)) glEnable(capability);
+    }
+
+    void Disable(GLenum capability) {
+        Cached* cached = Capability(capability);
+        if (cached == nullptr) stateChangeStats.issued++;
+        if (cached == nullptr || cached->Set(GL_FALSE)) glDisable(capability);
+    }
+
+    void BlendFunc(GLenum source, GLenum destination) {
+        if (blendFunc.Set(static_cast<GLint>(source), static_cast<GLint>(destination))) glBlendFunc(source, destination);
+    }
+
+    void DepthFunc(GLenum func) {
+        if (depthFunc.Set(static_cast<GLint>(func))) glDepthFunc(func);
+    }
+
+    void DepthMask(bool write) {
+        if (depthMask.Set(write ? GL_TRUE : GL_FALSE)) glDepthMask(write ? GL_TRUE : GL_FALSE);
+    }
+
+    void CullFace(GLenum face) {
+        if (cullFaceMode.Set(static_cast<GLint>(face))) glCullFace(face);
+    }
+
+    void FrontFace(GLenum mode) {
+        if (frontFace.Set(static_cast<GLint>(mode))) glFrontFace(mode);
+    }
+
+    void Invalidate() {
+        program = vertexArray = blend = cullFace = depthTest = blendFunc = depthFunc = depthMask = cullFaceMode = frontFace = Cached();
+    }
+}
@@ -0,0 +1,32 @@
+#pragma once
+#include <glad/glad.h>
+
+// Driver calls the state cache made and skipped, reset every frame for the HUD
+struct StateChangeStats {
+    int issued = 0;
+    int elided = 0;
+};
+inline StateChangeStats stateChangeStats;
+
+// The last program, vertex array, blend, face culling and depth state set through here, so setting the same
+// again never reaches the driver. Everything that changes these goes through GLState; ImGui's backend puts back
+// what it found, code that doesn't has to call Invalidate afterwards.
+namespace GLState {
+    void UseProgram(GLuint program);
+    GLuint GetProgram();
+    void BindVertexArray(GLuint vertexArray);
+    // Deleting the bound vertex array unbinds it, and its name may come back for a new one
+    void DeleteVertexArray(GLuint vertexArray);
+
+    // GL_BLEND, GL_CULL_FACE and GL_DEPTH_TEST are tracked, anything else always reaches the driver
+    void Enable(GLenum capability);
+    void Disable(GLenum capability);
+    void BlendFunc(GLenum source, GLenum destination);
+    void DepthFunc(GLenum func);
+    void DepthMask(bool write);
+    void CullFace(GLenum face);
+    void FrontFace(GLenum mode);
+
+    // Forgets everything, the next call of each kind reaches the driver
+    void Invalidate();
+}
@@ -1,14 +1,34 @@
 #pragma once
 #include <filesystem>
 #include "shapeSettings.h"
+#include "erosion.h"
 #include <glm/glm.hpp>
 
 extern ShapeSettings* shape;
 
 extern float rotationSpeed;
 extern float densityFalloff;
+extern int opticalDepthMode; // 0 = ray march, 1 = transmittance LUT, 2 = Chapman function
+extern float atmosphereThickness;
+extern bool multipleScattering;
+extern int atmosphereResolution; // 0 = full, 1 = half, 2 = quarter
+extern bool atmosphereViewLuts; // sky-view LUT and aerial perspective froxels
+extern bool temporalAtmosphere; // a quarter of the atmosphere pixels redrawn per frame
+extern bool cloudsEnabled;
+extern int cloudQuality; // 0 = low ... 3 = ultra, resolution and march steps
+extern float cloudCoverage;
+extern float cloudDensity;
 extern float gMie; // The Mie phase asymmetry factor ( < 0 means forward scattering, > 0 means backward scattering)
 extern bool atmosphereEnabled;
 extern bool firstPersonMode;
+extern bool octaveLodEnabled;
+extern bool shaderPermutations; // draw with programs built for the current layers and scattering settings
+extern bool showProfiler; // per-pass GPU and CPU timings window
+extern bool diskShaders; // read shaders/ from the working directory and reload edits, instead of the embedded copies
+
+extern ErosionSettings erosionSettings;
+extern ErosionJob erosionJob;
+extern bool hasBakedHeightmap;
+extern bool useBakedHeightmap;
 
 extern glm::vec3 lightColor;
\ No newline at end of file
@@ -0,0 +1,57 @@
+#include "heightmap.h"
+#include <memory>
+#include "craterNoiseFilter.h"
+#include "perlinNoiseFilter.h"
+#include "plateNoiseFilter.h"
+#include "threadPool.h"
+#include "worleyNoiseFilter.h"
+
+int CubeHeightmap::WrappedIndex(int face, int x, int y) const {
+    if (x >= 0 && x < size && y >= 0 && y < size) return Index(face, x, y);
+
+    glm::vec2 uv;
+    int neighbour = CubeMap::FaceCoords(CubeMap::Direction(face, CubeMap::TexelCenter(x, y, size)), uv);
+    return Index(neighbour, CubeMap::CoordToTexel(uv.x, size), CubeMap::CoordToTexel(uv.y, size));
+}
+
+bool BakeHeightmap(const std::vector<NoiseLayer>& layers, float seed, CubeHeightmap& heightmap,
+    const std::atomic<bool>* cancel) {
+    // Same selection as SetNoiseLayers: the first maxNoiseLayers layers, and only the first crater and plate layers
+    std::vector<std::unique_ptr<NoiseFilter>> filters;
+    bool haveCraters = false, havePlates = false;
+    for (size_t i = 0; i < layers.size() && i < maxNoiseLayers; i++) {
+        const NoiseLayer& layer = layers[i];
+        if (!layer.enabled) continue;
+        switch (layer.type) {
+        case NoiseType::Worley:
+            filters.emplace_back(new WorleyNoiseFilter(layer, seed));
+            break;
+        case NoiseType::Craters:
+            if (!haveCraters) filters.emplace_back(new CraterNoiseFilter(layer, seed));
+            haveCraters = true;
+            break;
+        case NoiseType::Plates:
+            if (!havePlates) filters.emplace_back(new PlateNoiseFilter(layer, seed));
+            havePlates = true;
+            break;
+        default:
+            filters.emplace_back(new PerlinNoiseFilter(layer, seed));
+            break;
+        }
+    }
+
+    const int size = heightmap.size;
+    ThreadPool::Shared().ParallelFor(CubeMap::faceCount * size, [&](int row) {
+        if (cancel && *cancel) return;
+        int face = row / size, y = row % size;
+        for (int x = 0; x < size; x++) {
+            glm::vec3 p = heightmap.TexelDirection(face, x, y);
+            float elevation = 0.0f;
+            for (const auto& filter : filters) {
+                elevation += filter->Evaluate(p);
+            }
+            heightmap.texels[heightmap.Index(face, x, y)] = elevation;
+        }
+    });
+    return !(cancel && *cancel);
+}
@@ -0,0 +1,29 @@
+#pragma once
+#include <atomic>
+#include <vector>
+#include "cubeMap.h"
+#include "noiseLayer.h"
+
+// Terrain elevation baked into a cube map, faces in GL order (see cubeMap.h),
+// so it uploads straight into a GL_TEXTURE_CUBE_MAP
+struct CubeHeightmap {
+    int size = 0;
+    std::vector<float> texels; // face by face, row by row
+
+    void Resize(int newSize) {
+        size = newSize;
+        texels.assign(static_cast<size_t>(CubeMap::faceCount) * size * size, 0.0f);
+    }
+    int Index(int face, int x, int y) const { return (face * size + y) * size + x; }
+    // Index of a texel whose coordinates may lie past the face edge, those continue on the neighbouring face
+    int WrappedIndex(int face, int x, int y) const;
+    // Direction of a texel center on the unit sphere
+    glm::vec3 TexelDirection(int face, int x, int y) const {
+        return glm::normalize(CubeMap::Direction(face, CubeMap::TexelCenter(x, y, size)));
+    }
+};
+
+// Evaluates the noise layers (the same way planet.vert does) at every texel, spread over the thread pool.
+// Returns false if cancel was raised before it finished.
+bool BakeHeightmap(const std::vector<NoiseLayer>& layers, float seed, CubeHeightmap& heightmap,
+    const std::atomic<bool>* cancel = nullptr);
@@ -1,13 +1,20 @@
 
 #include "engine.h"
+#include "programCache.h"
 #include <glad/glad.h>
 //imgui
 #include <imgui.h>
 #include <imgui_impl_glfw.h>
 #include <imgui_impl_opengl3.h>
+#include <cstring>
 
 
-int main() {
+int main(int argc, char** argv) {
+    // --disk-shaders reads shaders/ from the working directory and reloads edits, for working on them
+    for (int i = 1; i < argc; i++) {
+        if (std::strcmp(argv[i], "--disk-shaders") == 0) diskShaders = true;
+    }
+
     if (!glfwInit()) return -1;
 
     GLFWwindow* window = glfwCreateWindow(800, 600, "OpenGL Planet", NULL, NULL);
@@ -17,6 +24,7 @@ int main() {
     }
     glfwMakeContextCurrent(window);
     gladLoadGLLoader((GLADloadproc)glfwGetProcAddress);
+    ProgramCache::Init((GLADloadproc)glfwGetProcAddress);
 
     // Setup Dear ImGui context
     IMGUI_CHECKVERSION();
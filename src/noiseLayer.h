@@ -2,6 +2,24 @@
 #include <glm/glm.hpp>
 #include <sstream> 
 
+enum class NoiseType : int {
+    Perlin = 0,
+    Worley = 1,
+    Craters = 2,
+    Plates = 3,
+};
+
+// Which distance a Worley layer outputs
+enum class WorleyOutput : int {
+    F1 = 0,        // distance to the closest feature point
+    F2 = 1,        // distance to the second closest feature point
+    F2MinusF1 = 2, // cell borders
+};
+
+// Layers the GPU evaluates, the rest are ignored. 128 layers of 64 bytes stay well inside the 16 KB
+// every GL 3.3 driver allows for a uniform block, keep in sync with noiseLayers.glsl.
+const int maxNoiseLayers = 128;
+
 struct NoiseLayer {
     float strength = 0.5f;
     float roughness = 2.1f;
@@ -11,6 +29,16 @@ struct NoiseLayer {
     float minValue = 1.1f;
     glm::vec3 center = glm::vec3(0.0f);
     bool enabled = true;
+    NoiseType type = NoiseType::Perlin;
+    WorleyOutput worleyOutput = WorleyOutput::F1;
+
+    // Scattered features (craters): how many, and their radius range in radians on the
+    // planet, drawn from a power law so small ones are far more common.
+    // Plates use featureCount as the plate count and maxFeatureSize as the border width.
+    int featureCount = 2000;
+    float minFeatureSize = 0.01f;
+    float maxFeatureSize = 0.2f;
+    float sizeExponent = 2.0f;
 
     NoiseLayer() = default;
 
@@ -22,7 +50,9 @@ struct NoiseLayer {
         ss << strength << " " << roughness << " " << baseRoughness << " "
             << octaves << " " << persistence << " " << minValue << " "
             << center.x << " " << center.y << " " << center.z << " "
-            << enabled;
+            << enabled << " "
+            << static_cast<int>(type) << " " << static_cast<int>(worleyOutput) << " "
+            << featureCount << " " << minFeatureSize << " " << maxFeatureSize << " " << sizeExponent;
         return ss.str();
     }
 
@@ -32,6 +62,21 @@ struct NoiseLayer {
             >> octaves >> persistence >> minValue
             >> center.x >> center.y >> center.z
             >> enabled;
+
+        // Configs saved before layer types existed are all Perlin
+        int typeValue = 0, worleyOutputValue = 0;
+        if (ss >> typeValue >> worleyOutputValue) {
+            type = static_cast<NoiseType>(typeValue);
+            worleyOutput = static_cast<WorleyOutput>(worleyOutputValue);
+        }
+        int count = 0;
+        float minSize = 0.0f, maxSize = 0.0f, exponent = 0.0f;
+        if (ss >> count >> minSize >> maxSize >> exponent) {
+            featureCount = count;
+            minFeatureSize = minSize;
+            maxFeatureSize = maxSize;
+            sizeExponent = exponent;
+        }
     }
 };
 
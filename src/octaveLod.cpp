@@ -0,0 +1,34 @@
+#include "octaveLod.h"
+#include <algorithm>
+#include <cmath>
+
+float ComputeVisibleOctaves(const NoiseLayer& layer, float planetRadius, float cameraDistance,
+    int meshResolution, float fovY, int viewportHeight, float maxPixelError) {
+    const float halfPi = 1.5707963f;
+    float maxOctaves = static_cast<float>(layer.octaves);
+    if (layer.octaves <= 1 || layer.roughness <= 1.0f || layer.baseRoughness <= 0.0f) {
+        return maxOctaves;
+    }
+
+    // Each cube face spans a quarter of a great circle, so this is the average distance
+    // between two neighbouring vertices. Anything shorter than two of those just aliases.
+    float vertexSpacing = planetRadius * halfPi / std::max(meshResolution - 1, 1);
+    float minWavelength = 2.0f * vertexSpacing;
+
+    // World size of one pixel at the closest point of the planet
+    float surfaceDistance = std::max(cameraDistance - planetRadius, 0.001f);
+    float pixelSize = surfaceDistance * 2.0f * std::tan(fovY * 0.5f) / std::max(viewportHeight, 1);
+
+    // Mesh limit: octave i has a wavelength of planetRadius / (baseRoughness * roughness^i)
+    float meshOctaves = 1.0f + std::log(planetRadius / (layer.baseRoughness * minWavelength)) / std::log(layer.roughness);
+
+    // Screen-space limit: octave i displaces the surface by at most
+    // planetRadius * 0.5 * strength * persistence^i (see EvaluateNoise in planet.vert)
+    float screenOctaves = maxOctaves;
+    float baseAmplitude = planetRadius * 0.5f * layer.strength;
+    if (layer.persistence > 0.0f && layer.persistence < 1.0f && baseAmplitude > 0.0f) {
+        screenOctaves = 1.0f + std::log(maxPixelError * pixelSize / baseAmplitude) / std::log(layer.persistence);
+    }
+
+    return std::clamp(std::min(meshOctaves, screenOctaves), 1.0f, maxOctaves);
+}
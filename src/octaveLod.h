@@ -0,0 +1,9 @@
+#pragma once
+#include "noiseLayer.h"
+
+// Screen-space-error octave LOD for the terrain noise.
+// An octave is only worth evaluating if the mesh can represent its wavelength and its
+// displacement is at least maxPixelError pixels on screen. The result is fractional:
+// the shader fades the last octave in by the fractional part, so LOD changes don't pop.
+float ComputeVisibleOctaves(const NoiseLayer& layer, float planetRadius, float cameraDistance,
+    int meshResolution, float fovY, int viewportHeight, float maxPixelError = 1.0f);
@@ -0,0 +1,14 @@
+#include "parameterStore.h"
+
+void ParameterStore::SetValue(UniformId name, Value value) {
+    auto found = indices.find(name.hash);
+    if (found == indices.end()) {
+        indices.emplace(name.hash, parameters.size());
+        parameters.push_back({ name.hash, std::move(value), ++version });
+        return;
+    }
+    Parameter& parameter = parameters[found->second];
+    if (parameter.value == value) return;
+    parameter.value = std::move(value);
+    parameter.version = ++version;
+}
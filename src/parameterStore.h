@@ -0,0 +1,36 @@
+#pragma once
+#include <cstdint>
+#include <unordered_map>
+#include <variant>
+#include <vector>
+#include <glm/glm.hpp>
+#include "shader.h"
+
+// Uniform values shared by the programs, each with a version that moves whenever its value changes.
+// Programs remember the versions they uploaded (see Shader::Upload), so a value that's set every frame
+// only reaches the driver in the frames it actually changed. Every program takes the names it declares.
+class ParameterStore {
+public:
+    using Value = std::variant<float, int, bool, glm::vec2, glm::vec3, glm::mat4>;
+    struct Parameter {
+        uint32_t nameHash;
+        Value value;
+        uint64_t version;
+    };
+
+    // The version only moves if the value differs from the stored one
+    template <typename T>
+    void Set(UniformId name, const T& value) { SetValue(name, Value(value)); }
+
+    // In the order they were first set, indices stay valid
+    const std::vector<Parameter>& GetParameters() const { return parameters; }
+    // Newest version of any parameter
+    uint64_t GetVersion() const { return version; }
+
+private:
+    void SetValue(UniformId name, Value value);
+
+    std::vector<Parameter> parameters;
+    std::unordered_map<uint32_t, size_t> indices; // by name hash
+    uint64_t version = 0;
+};
@@ -1,25 +1,55 @@
-
 #include "perlinNoiseFilter.h"
-#include "noiseLayer.h"
-#include <glm/gtc/noise.hpp>
 #include <algorithm>
+#include <cmath>
+
+namespace {
+    glm::vec3 Fade(const glm::vec3& t) {
+        return t * t * t * (t * (t * 6.0f - 15.0f) + 10.0f);
+    }
+}
+
+PerlinNoiseFilter::PerlinNoiseFilter(const NoiseLayer& settings, float seed) : settings(settings), seed(seed) {}
+
+// rand() of noise.glsl
+float PerlinNoiseFilter::Rand(const glm::vec3& p) const {
+    float value = std::sin(p.x * 127.1f + p.y * 311.7f + p.z * 74.7f + seed) * 43758.5453f;
+    return (value - std::floor(value)) * 2.0f - 1.0f;
+}
+
+glm::vec3 PerlinNoiseFilter::Gradient(int x, int y, int z) const {
+    glm::vec3 p(static_cast<float>(x), static_cast<float>(y), static_cast<float>(z));
+    return glm::normalize(glm::vec3(Rand(p + glm::vec3(1.0f, 0.0f, 0.0f)), Rand(p + glm::vec3(0.0f, 1.0f, 0.0f)),
+        Rand(p + glm::vec3(0.0f, 0.0f, 1.0f))));
+}
 
-PerlinNoiseFilter::PerlinNoiseFilter(const NoiseLayer& settings) : settings(settings) {}
+float PerlinNoiseFilter::Noise(const glm::vec3& pos) const {
+    glm::vec3 cell = glm::floor(pos);
+    glm::vec3 pf = pos - cell;
+    glm::vec3 f = Fade(pf);
+    int x = static_cast<int>(cell.x), y = static_cast<int>(cell.y), z = static_cast<int>(cell.z);
 
+    auto corner = [&](int dx, int dy, int dz) {
+        return glm::dot(Gradient(x + dx, y + dy, z + dz), pf - glm::vec3(dx, dy, dz));
+    };
+    float x00 = glm::mix(corner(0, 0, 0), corner(1, 0, 0), f.x);
+    float x10 = glm::mix(corner(0, 1, 0), corner(1, 1, 0), f.x);
+    float x01 = glm::mix(corner(0, 0, 1), corner(1, 0, 1), f.x);
+    float x11 = glm::mix(corner(0, 1, 1), corner(1, 1, 1), f.x);
+    return glm::mix(glm::mix(x00, x10, f.y), glm::mix(x01, x11, f.y), f.z);
+}
+
+// Same layer formula as EvaluateNoise in planet.vert, with all octaves (no LOD)
 float PerlinNoiseFilter::Evaluate(const glm::vec3& point) const {
     float noiseValue = 0.0f;
     float frequency = settings.baseRoughness;
     float amplitude = 1.0f;
-    glm::vec3 p = point + settings.center;
 
     for (int i = 0; i < settings.octaves; i++) {
-        float v = glm::perlin(p * frequency);
-        noiseValue += (v + 1.0f) * 0.5f * amplitude;
-
+        noiseValue += Noise(point * frequency) * amplitude;
         frequency *= settings.roughness;
         amplitude *= settings.persistence;
     }
 
-    noiseValue = std::max(0.0f, noiseValue - settings.minValue);
-    return noiseValue * settings.strength;
+    float layerValue = noiseValue * settings.strength - settings.minValue;
+    return std::max(0.0f, 0.5f + 0.5f * layerValue);
 }
@@ -1,13 +1,22 @@
-
 #pragma once
 #include "noiseFilter.h"
 #include "noiseLayer.h"
 
+// CPU version of the gradient noise in noise.glsl, for baking the terrain on the CPU. It uses the same sin based
+// lattice hash in float, but GPUs evaluate sin less precisely, so the bake follows the live terrain closely rather
+// than bit for bit. Erosion only needs the bake to be reproducible on the CPU.
 class PerlinNoiseFilter : public NoiseFilter {
 public:
-    PerlinNoiseFilter(const NoiseLayer& settings);
+    PerlinNoiseFilter(const NoiseLayer& settings, float seed);
     virtual float Evaluate(const glm::vec3& point) const override;
 
+    // perlinNoise() of noise.glsl, roughly in [-1, 1]
+    float Noise(const glm::vec3& pos) const;
+
 private:
+    float Rand(const glm::vec3& p) const;
+    glm::vec3 Gradient(int x, int y, int z) const;
+
     NoiseLayer settings;
+    float seed;
 };
@@ -1,5 +1,6 @@
 #include "planetUI.h"
 #include "globals.h"
+#include "benchmarks.h"
 #include <fstream>
 #include <filesystem>
 #include <algorithm>
@@ -39,12 +40,39 @@ namespace PlanetUI {
             changed |= ImGui::Checkbox("Enabled", &layer->enabled);
 
             if (layer->enabled) {
-                changed |= ImGui::SliderFloat("Strength", &layer->strength, 0.0f, 2.0f);
-                changed |= ImGui::SliderFloat("Roughness", &layer->roughness, 0.0f, 5.0f);
-                changed |= ImGui::SliderFloat("Base Roughness", &layer->baseRoughness, 0.0f, 5.0f);
-                changed |= ImGui::SliderInt("Octaves", &layer->octaves, 1, 10);
-                changed |= ImGui::SliderFloat("Persistence", &layer->persistence, 0.0f, 1.0f);
-                changed |= ImGui::SliderFloat("Min Value", &layer->minValue, 0.0f, 2.0f);
+                int type = static_cast<int>(layer->type);
+                if (ImGui::Combo("Type", &type, "Perlin\0Worley\0Craters\0Plates\0")) {
+                    layer->type = static_cast<NoiseType>(type);
+                    changed = true;
+                }
+                if (layer->type == NoiseType::Worley) {
+                    int output = static_cast<int>(layer->worleyOutput);
+                    if (ImGui::Combo("Output", &output, "F1\0F2\0F2 - F1\0")) {
+                        layer->worleyOutput = static_cast<WorleyOutput>(output);
+                        changed = true;
+                    }
+                }
+                if (layer->type == NoiseType::Craters) {
+                    changed |= ImGui::SliderFloat("Strength", &layer->strength, 0.0f, 2.0f);
+                    changed |= ImGui::SliderInt("Crater Count", &layer->featureCount, 0, 1000000, "%d", ImGuiSliderFlags_Logarithmic);
+                    changed |= ImGui::SliderFloat("Min Size", &layer->minFeatureSize, 0.001f, 0.1f, "%.4f", ImGuiSliderFlags_Logarithmic);
+                    changed |= ImGui::SliderFloat("Max Size", &layer->maxFeatureSize, 0.001f, 0.5f, "%.4f", ImGuiSliderFlags_Logarithmic);
+                    changed |= ImGui::SliderFloat("Size Exponent", &layer->sizeExponent, 0.5f, 4.0f);
+                    layer->maxFeatureSize = std::max(layer->maxFeatureSize, layer->minFeatureSize);
+                }
+                else if (layer->type == NoiseType::Plates) {
+                    changed |= ImGui::SliderFloat("Strength", &layer->strength, 0.0f, 2.0f);
+                    changed |= ImGui::SliderInt("Plate Count", &layer->featureCount, 1, 100000, "%d", ImGuiSliderFlags_Logarithmic);
+                    changed |= ImGui::SliderFloat("Border Width", &layer->maxFeatureSize, 0.005f, 0.5f, "%.3f", ImGuiSliderFlags_Logarithmic);
+                }
+                else {
+                    changed |= ImGui::SliderFloat("Strength", &layer->strength, 0.0f, 2.0f);
+                    changed |= ImGui::SliderFloat("Roughness", &layer->roughness, 0.0f, 5.0f);
+                    changed |= ImGui::SliderFloat("Base Roughness", &layer->baseRoughness, 0.0f, 5.0f);
+                    changed |= ImGui::SliderInt("Octaves", &layer->octaves, 1, 10);
+                    changed |= ImGui::SliderFloat("Persistence", &layer->persistence, 0.0f, 1.0f);
+                    changed |= ImGui::SliderFloat("Min Value", &layer->minValue, 0.0f, 2.0f);
+                }
             }
 
             ImGui::SameLine();
@@ -121,12 +149,113 @@ namespace PlanetUI {
         }
     }
 
+    void DrawBenchmarkControls(ShapeSettings* shape) {
+        static std::vector<Benchmarks::Result> results;
+
+        if (ImGui::Button("Worley vs Brute Force")) {
+            results.push_back(Benchmarks::WorleyVsBruteForce(shape->seed));
+        }
+        ImGui::SameLine();
+        if (ImGui::Button("Craters vs Brute Force")) {
+            results.push_back(Benchmarks::CratersVsBruteForce(shape->seed));
+        }
+        ImGui::SameLine();
+        if (ImGui::Button("1M Crater Budget")) {
+            results.push_back(Benchmarks::CraterFieldBudget(shape->seed));
+        }
+        ImGui::SameLine();
+        if (ImGui::Button("Plates vs Brute Force")) {
+            results.push_back(Benchmarks::PlatesVsBruteForce(shape->seed));
+        }
+        ImGui::SameLine();
+        if (ImGui::Button("Chapman vs Ray March")) {
+            AtmosphereParams params;
+            params.planetRadius = shape->radius;
+            params.atmosphereRadius = shape->radius * (1.0f + atmosphereThickness);
+            params.densityFalloff = densityFalloff;
+            results.push_back(Benchmarks::ChapmanVsRayMarch(params));
+        }
+        ImGui::SameLine();
+        if (ImGui::Button("Scattering vs Reference")) {
+            results.push_back(Benchmarks::ScatteringVsReference(CurrentScatteringSettings()));
+        }
+        ImGui::SameLine();
+        if (ImGui::Button("Render Reference Sky")) {
+            RenderReferenceSky("atmosphere_reference.ppm", 320, 180);
+        }
+
+        for (const Benchmarks::Result& result : results) {
+            if (result.referenceMilliseconds > 0.0) {
+                ImGui::Text("%s (%d samples): %.2f ms vs %.2f ms reference (%.1fx), max error %g",
+                    result.name.c_str(), result.samples, result.milliseconds, result.referenceMilliseconds,
+                    result.referenceMilliseconds / std::max(result.milliseconds, 1e-6), result.maxError);
+            }
+            else {
+                ImGui::Text("%s (%d samples): %.2f ms", result.name.c_str(), result.samples, result.milliseconds);
+            }
+            if (result.setupMilliseconds > 0.0) {
+                ImGui::SameLine();
+                ImGui::Text(", setup %.1f ms", result.setupMilliseconds);
+            }
+            if (result.budgetMilliseconds > 0.0) {
+                bool withinBudget = result.milliseconds <= result.budgetMilliseconds;
+                ImGui::SameLine();
+                ImGui::TextColored(withinBudget ? ImVec4(0, 1, 0, 1) : ImVec4(1, 0, 0, 1), "budget %.1f ms", result.budgetMilliseconds);
+            }
+        }
+    }
+
+    void DrawErosionControls() {
+        static const int resolutions[] = { 128, 256, 512, 1024, 2048 };
+        static const char* resolutionNames = "128\0" "256\0" "512\0" "1024\0" "2048\0";
+        int resolutionIndex = 0;
+        while (resolutionIndex < 4 && resolutions[resolutionIndex] < erosionSettings.resolution) resolutionIndex++;
+        if (ImGui::Combo("Resolution", &resolutionIndex, resolutionNames)) {
+            erosionSettings.resolution = resolutions[resolutionIndex];
+        }
+
+        ImGui::SliderFloat("Droplets per Texel", &erosionSettings.dropletsPerTexel, 0.0f, 8.0f);
+        ImGui::SliderInt("Passes", &erosionSettings.passes, 1, 32);
+        ImGui::SliderInt("Droplet Lifetime", &erosionSettings.maxLifetime, 1, 128);
+        ImGui::SliderFloat("Inertia", &erosionSettings.inertia, 0.0f, 1.0f);
+        ImGui::SliderFloat("Capacity", &erosionSettings.capacity, 0.0f, 16.0f);
+        ImGui::SliderFloat("Erosion Rate", &erosionSettings.erosionRate, 0.0f, 1.0f);
+        ImGui::SliderFloat("Deposition Rate", &erosionSettings.depositionRate, 0.0f, 1.0f);
+        ImGui::SliderFloat("Evaporation", &erosionSettings.evaporation, 0.0f, 0.5f);
+        ImGui::SliderInt("Thermal Iterations", &erosionSettings.thermalIterations, 0, 200);
+        ImGui::SliderFloat("Talus Slope", &erosionSettings.talusSlope, 0.05f, 4.0f);
+        ImGui::SliderFloat("Thermal Rate", &erosionSettings.thermalRate, 0.0f, 0.5f);
+
+        if (erosionJob.IsRunning()) {
+            ImGui::ProgressBar(erosionJob.GetProgress());
+            if (ImGui::Button("Cancel")) {
+                erosionJob.Cancel();
+            }
+        }
+        else if (ImGui::Button("Bake and Erode")) {
+            StartErosion();
+        }
+
+        ImGui::BeginDisabled(!hasBakedHeightmap);
+        ImGui::Checkbox("Use Baked Heightmap", &useBakedHeightmap);
+        ImGui::EndDisabled();
+    }
+
     bool autoRegen = true;
     void DrawMainControls(ShapeSettings* shape, std::function<void()> onRegenerate) {
         ImGui::Begin("Planet Editor");
         //ImGui::SliderFloat("Planet Radius", &shape->radius, 0.0f, 10.0f);
         ImGui::SliderFloat("Rotation Speed", &rotationSpeed, 0.0, 3.0f);
         ImGui::SliderFloat("Density Falloff", &densityFalloff, 0.0, 30.0f);
+        ImGui::Combo("Optical Depth", &opticalDepthMode, "Ray March\0Transmittance LUT\0Chapman Function\0");
+        ImGui::Checkbox("Multiple Scattering", &multipleScattering);
+        ImGui::Combo("Atmosphere Resolution", &atmosphereResolution, "Full\0Half\0Quarter\0");
+        ImGui::Checkbox("Sky-View and Aerial Perspective LUTs", &atmosphereViewLuts);
+        ImGui::Checkbox("Temporal Atmosphere", &temporalAtmosphere);
+        ImGui::Checkbox("Clouds", &cloudsEnabled);
+        ImGui::Combo("Cloud Quality", &cloudQuality, "Low\0Medium\0High\0Ultra\0");
+        ImGui::SliderFloat("Cloud Coverage", &cloudCoverage, 0.0f, 1.0f);
+        ImGui::SliderFloat("Cloud Density", &cloudDensity, 1.0f, 100.0f);
         
         bool seedChanged = ImGui::SliderFloat("Terrain Seed", &shape->seed, 0.0f, 100.0f);
         if (seedChanged && autoRegen) {
@@ -135,6 +264,9 @@ namespace PlanetUI {
         
         ImGui::Checkbox("Atmosphere", &atmosphereEnabled);
         ImGui::Checkbox("First Person", &firstPersonMode);
+        ImGui::Checkbox("Octave LOD", &octaveLodEnabled);
+        ImGui::Checkbox("Shader Permutations", &shaderPermutations);
+        ImGui::Checkbox("Profiler", &showProfiler);
         ImGui::SliderFloat("G Mie", &gMie, -0.999f, 0.999f);
 		ImGui::ColorEdit3("Light Color", (float*) &lightColor);
         bool update = DrawNoiseLayerControls(shape);
@@ -147,6 +279,14 @@ namespace PlanetUI {
 
         DrawSaveLoadControls(shape);
 
+        if (ImGui::CollapsingHeader("Erosion")) {
+            DrawErosionControls();
+        }
+
+        if (ImGui::CollapsingHeader("Benchmarks")) {
+            DrawBenchmarkControls(shape);
+        }
+
         ImGui::End();
     }
 
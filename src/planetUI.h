@@ -7,4 +7,6 @@ namespace PlanetUI {
     bool DrawNoiseLayerControls(ShapeSettings* shape);
     void DrawMainControls(ShapeSettings* shape, std::function<void()> onRegenerate);
     void DrawSaveLoadControls(ShapeSettings* shape);
+    void DrawBenchmarkControls(ShapeSettings* shape);
+    void DrawErosionControls();
 }
\ No newline at end of file
@@ -0,0 +1,132 @@
+#include "plateNoiseFilter.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <random>
+#include "cubeMap.h"
+#include "threadPool.h"
+
+namespace {
+    const float continentalFraction = 0.4f;
+
+    std::vector<glm::vec3> ScatterSites(int count, float seed) {
+        uint32_t seedBits;
+        std::memcpy(&seedBits, &seed, sizeof(seedBits));
+        std::mt19937 rng(seedBits ^ 0x7f4a7c15u);
+        std::normal_distribution<float> gauss;
+
+        std::vector<glm::vec3> sites(std::max(count, 0));
+        for (glm::vec3& site : sites) {
+            site = glm::normalize(glm::vec3(gauss(rng), gauss(rng), gauss(rng)));
+        }
+        return sites;
+    }
+}
+
+PlateNoiseFilter::PlateNoiseFilter(const NoiseLayer& settings, float seed)
+    : settings(settings), triangulation(ScatterSites(settings.featureCount, seed)) {
+    uint32_t seedBits;
+    std::memcpy(&seedBits, &seed, sizeof(seedBits));
+    std::mt19937 rng(seedBits ^ 0x2545f491u);
+    std::normal_distribution<float> gauss;
+    std::uniform_real_distribution<float> uniform(0.0f, 1.0f);
+
+    const std::vector<glm::vec3>& sites = triangulation.GetSites();
+    plates.resize(sites.size());
+    for (size_t i = 0; i < sites.size(); i++) {
+        TectonicPlate& plate = plates[i];
+        plate.site = sites[i];
+        bool continental = uniform(rng) < continentalFraction;
+        plate.height = continental ? 0.5f + 0.5f * uniform(rng) : 0.2f * uniform(rng);
+        glm::vec3 pole = glm::normalize(glm::vec3(gauss(rng), gauss(rng), gauss(rng)));
+        plate.rotation = pole * (0.2f + 0.8f * uniform(rng));
+    }
+
+    softness = Softness(settings.maxFeatureSize, static_cast<int>(plates.size()));
+}
+
+float PlateNoiseFilter::Softness(float borderWidth, int plateCount) {
+    // Across a border dot(p, site) changes by the width times the distance between the sites,
+    // which is about the average plate spacing
+    float spacing = std::sqrt(4.0f * 3.1415927f / std::max(plateCount, 1));
+    return std::max(borderWidth, 1e-4f) * spacing;
+}
+
+int PlateNoiseFilter::Locate(const glm::vec3& pointOnUnitSphere) const {
+    return plates.empty() ? -1 : triangulation.Locate(pointOnUnitSphere);
+}
+
+float PlateNoiseFilter::Height(const glm::vec3& pointOnUnitSphere) const {
+    return Height(pointOnUnitSphere, Locate(pointOnUnitSphere));
+}
+
+// Keep in sync with plateHeight in plates.glsl
+float PlateNoiseFilter::Height(const glm::vec3& pointOnUnitSphere, int plate) const {
+    if (plate < 0) return 0.0f;
+    const glm::vec3& p = pointOnUnitSphere;
+    const std::vector<int>& offsets = triangulation.GetNeighbourOffsets();
+    const std::vector<int>& neighbours = triangulation.GetNeighbours();
+
+    // The lookup may start next to the right plate (a cube map texel straddling a border), walk there first
+    plate = triangulation.LocateFrom(p, plate);
+    float closest = glm::dot(p, plates[plate].site);
+
+    // Every plate less than softness further away than the closest one gets a weight that falls to 0 there.
+    // Sites inside a cap around p are connected through Delaunay edges inside it, so growing the set
+    // through neighbours finds all of them. Nothing with a weight is missed, so it's seamless everywhere.
+    int ids[maxBlendPlates];
+    float weights[maxBlendPlates];
+    int count = 1;
+    ids[0] = plate;
+    weights[0] = 1.0f;
+    float total = 1.0f;
+    for (int n = 0; n < count; n++) {
+        for (int i = offsets[ids[n]]; i < offsets[ids[n] + 1] && count < maxBlendPlates; i++) {
+            int other = neighbours[i];
+            float falloff = 1.0f - (closest - glm::dot(p, plates[other].site)) / softness;
+            if (falloff <= 0.0f || std::find(ids, ids + count, other) != ids + count) continue;
+            ids[count] = other;
+            weights[count] = falloff * falloff * falloff;
+            total += weights[count];
+            count++;
+        }
+    }
+
+    float height = 0.0f;
+    for (int i = 0; i < count; i++) {
+        weights[i] /= total;
+        height += weights[i] * plates[ids[i]].height;
+    }
+
+    // Ridges and rifts along each border, 4 * wi * wj peaks at 1 where two plates meet
+    for (int i = 0; i < count; i++) {
+        const TectonicPlate& a = plates[ids[i]];
+        for (int j = i + 1; j < count; j++) {
+            const TectonicPlate& b = plates[ids[j]];
+            float convergence = glm::dot(glm::cross(a.rotation - b.rotation, p), glm::normalize(b.site - a.site));
+            height += 4.0f * weights[i] * weights[j] * convergence * ridgeHeight;
+        }
+    }
+    return std::max(height, 0.0f);
+}
+
+float PlateNoiseFilter::Evaluate(const glm::vec3& point) const {
+    return Height(glm::normalize(point)) * settings.strength;
+}
+
+std::vector<int> PlateNoiseFilter::BakeCells(int faceResolution) const {
+    std::vector<int> cells(static_cast<size_t>(CubeMap::faceCount) * faceResolution * faceResolution, -1);
+    if (plates.empty()) return cells;
+
+    ThreadPool::Shared().ParallelFor(CubeMap::faceCount * faceResolution, [&](int row) {
+        int face = row / faceResolution, y = row % faceResolution;
+        int plate = -1;
+        for (int x = 0; x < faceResolution; x++) {
+            glm::vec3 p = glm::normalize(CubeMap::Direction(face, CubeMap::TexelCenter(x, y, faceResolution)));
+            // Neighbouring texels are mostly on the same plate, so walk from the last one
+            plate = plate < 0 ? triangulation.Locate(p) : triangulation.LocateFrom(p, plate);
+            cells[row * faceResolution + x] = plate;
+        }
+    });
+    return cells;
+}
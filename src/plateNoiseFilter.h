@@ -0,0 +1,46 @@
+#pragma once
+#include <vector>
+#include "noiseFilter.h"
+#include "noiseLayer.h"
+#include "sphericalDelaunay.h"
+
+struct TectonicPlate {
+    glm::vec3 site;     // Voronoi site of the plate on the unit sphere
+    float height;       // continental plates sit high, oceanic ones low
+    glm::vec3 rotation; // Euler pole times angular speed, the plate moves at cross(rotation, p)
+};
+
+// Tectonic plates: the spherical Voronoi cells of featureCount random sites, each with its own
+// height and motion. Plates blend into their neighbours over the border width (maxFeatureSize),
+// with ridges where they converge and rifts where they pull apart.
+// plates.glsl evaluates the same thing from a baked cell cube map (see BakeCells).
+class PlateNoiseFilter : public NoiseFilter {
+public:
+    PlateNoiseFilter(const NoiseLayer& settings, float seed);
+    virtual float Evaluate(const glm::vec3& point) const override;
+
+    // Plate containing a point on the unit sphere, -1 if there are none
+    int Locate(const glm::vec3& pointOnUnitSphere) const;
+    float Height(const glm::vec3& pointOnUnitSphere) const;
+    // Height given the plate the point is in, or one close to it
+    float Height(const glm::vec3& pointOnUnitSphere, int plate) const;
+
+    // Locate at every texel center of a faceResolution cube map, faces in GL order
+    std::vector<int> BakeCells(int faceResolution) const;
+
+    const std::vector<TectonicPlate>& GetPlates() const { return plates; }
+    const SphericalDelaunay& GetTriangulation() const { return triangulation; }
+    // How much smaller dot(p, site) can be than for the closest plate for a plate to still blend in
+    float GetSoftness() const { return softness; }
+    static float Softness(float borderWidth, int plateCount);
+
+    static constexpr float ridgeHeight = 0.5f;
+    // Most plates blended at one point
+    static const int maxBlendPlates = 16;
+
+private:
+    NoiseLayer settings;
+    SphericalDelaunay triangulation;
+    std::vector<TectonicPlate> plates;
+    float softness = 1.0f;
+};
@@ -0,0 +1,200 @@
+#include "profiler.h"
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <imgui.h>
+
+void Profiler::Series::Add(long long frame, float value) {
+    if (ms.empty()) {
+        ms.resize(historyFrames);
+        frames.resize(historyFrames);
+    }
+    ms[next] = value;
+    frames[next] = frame;
+    next = (next + 1) % historyFrames;
+    if (count < historyFrames) count++;
+}
+
+Profiler::Stats Profiler::Series::Compute() const {
+    Stats stats;
+    if (count == 0) return stats;
+    std::vector<float> sorted(ms.begin(), ms.begin() + count);
+    std::sort(sorted.begin(), sorted.end());
+    float total = 0.0f;
+    for (float value : sorted) total += value;
+    stats.last = ms[(next + historyFrames - 1) % historyFrames];
+    stats.min = sorted.front();
+    stats.max = sorted.back();
+    stats.average = total / count;
+    stats.p99 = sorted[std::max((count * 99 + 99) / 100 - 1, 0)];
+    return stats;
+}
+
+void Profiler::Destroy() {
+    for (FrameQueries& slot : queries) {
+        if (!slot.pool.empty()) glDeleteQueries(static_cast<GLsizei>(slot.pool.size()), slot.pool.data());
+        slot = FrameQueries();
+    }
+}
+
+void Profiler::BeginFrame() {
+    FrameQueries& slot = queries[frame % queryFrames];
+    CollectQueries(slot);
+    slot.frame = frame;
+    BeginCpu("Frame");
+}
+
+void Profiler::EndFrame() {
+    // Zones left open by an early return end with the frame
+    if (gpuDepth > 0) {
+        gpuDepth = 1;
+        EndGpu();
+    }
+    while (!cpuZones.empty()) EndCpu();
+
+    for (Series& zone : series) {
+        if (zone.gpu || !zone.timed) continue;
+        zone.Add(frame, zone.pending);
+        zone.pending = 0.0f;
+        zone.timed = false;
+    }
+    frame++;
+}
+
+void Profiler::BeginGpu(const char* name) {
+    if (gpuDepth++ > 0) return;
+    FrameQueries& slot = queries[frame % queryFrames];
+    if (slot.series.size() == slot.pool.size()) {
+        GLuint query;
+        glGenQueries(1, &query);
+        slot.pool.push_back(query);
+    }
+    glBeginQuery(GL_TIME_ELAPSED, slot.pool[slot.series.size()]);
+    slot.series.push_back(FindSeries(name, true));
+}
+
+void Profiler::EndGpu() {
+    if (gpuDepth == 0 || --gpuDepth > 0) return;
+    glEndQuery(GL_TIME_ELAPSED);
+}
+
+void Profiler::BeginCpu(const char* name) {
+    cpuZones.push_back({ FindSeries(name, false), Clock::now() });
+}
+
+void Profiler::EndCpu() {
+    if (cpuZones.empty()) return;
+    OpenZone zone = cpuZones.back();
+    cpuZones.pop_back();
+    Series& timed = series[zone.series];
+    timed.pending += std::chrono::duration<float, std::milli>(Clock::now() - zone.start).count();
+    timed.timed = true;
+}
+
+int Profiler::FindSeries(const char* name, bool gpu) {
+    for (size_t i = 0; i < series.size(); i++) {
+        if (series[i].gpu == gpu && std::strcmp(series[i].name.c_str(), name) == 0) return static_cast<int>(i);
+    }
+    Series added;
+    added.name = name;
+    added.gpu = gpu;
+    series.push_back(std::move(added));
+    return static_cast<int>(series.size()) - 1;
+}
+
+void Profiler::CollectQueries(FrameQueries& slot) {
+    if (slot.frame < 0 || slot.series.empty()) {
+        slot.series.clear();
+        return;
+    }
+    bool available = true;
+    for (size_t i = 0; i < slot.series.size() && available; i++) {
+        GLint done = GL_FALSE;
+        glGetQueryObjectiv(slot.pool[i], GL_QUERY_RESULT_AVAILABLE, &done);
+        available = done == GL_TRUE;
+    }
+    if (!available) {
+        droppedFrames++;
+        slot.series.clear();
+        return;
+    }
+
+    std::vector<float> totals(series.size(), -1.0f);
+    for (size_t i = 0; i < slot.series.size(); i++) {
+        GLuint64 nanoseconds = 0;
+        glGetQueryObjectui64v(slot.pool[i], GL_QUERY_RESULT, &nanoseconds);
+        float& total = totals[slot.series[i]];
+        total = std::max(total, 0.0f) + static_cast<float>(nanoseconds / 1.0e6);
+    }
+    for (size_t i = 0; i < totals.size(); i++) {
+        if (totals[i] >= 0.0f) series[i].Add(slot.frame, totals[i]);
+    }
+    slot.series.clear();
+}
+
+void Profiler::DrawWindow(bool* open) {
+    ImGui::SetNextWindowSize(ImVec2(560, 320), ImGuiCond_FirstUseEver);
+    if (!ImGui::Begin("Profiler", open)) {
+        ImGui::End();
+        return;
+    }
+    ImGui::Text("Last %d frames, GPU times lag %d frames, %d frames of GPU times dropped", historyFrames, queryFrames,
+        droppedFrames);
+
+    static char path[256] = "profile.csv";
+    ImGui::InputText("##Path", path, sizeof(path));
+    ImGui::SameLine();
+    if (ImGui::Button("Export CSV")) {
+        exportMessage = ExportCsv(path) ? std::string("Wrote ") + path : std::string("Failed to write ") + path;
+    }
+    if (!exportMessage.empty()) ImGui::TextUnformatted(exportMessage.c_str());
+
+    if (ImGui::BeginTable("Zones", 6, ImGuiTableFlags_RowBg | ImGuiTableFlags_SizingFixedFit)) {
+        ImGui::TableSetupColumn("Zone");
+        ImGui::TableSetupColumn("Last");
+        ImGui::TableSetupColumn("Min");
+        ImGui::TableSetupColumn("Avg");
+        ImGui::TableSetupColumn("P99");
+        ImGui::TableSetupColumn("ms", ImGuiTableColumnFlags_WidthStretch);
+        ImGui::TableHeadersRow();
+        for (const Series& zone : series) {
+            Stats stats = zone.Compute();
+            ImGui::TableNextRow();
+            ImGui::TableNextColumn();
+            ImGui::Text("%s %s", zone.gpu ? "GPU" : "CPU", zone.name.c_str());
+            ImGui::TableNextColumn();
+            ImGui::Text("%.2f", stats.last);
+            ImGui::TableNextColumn();
+            ImGui::Text("%.2f", stats.min);
+            ImGui::TableNextColumn();
+            ImGui::Text("%.2f", stats.average);
+            ImGui::TableNextColumn();
+            ImGui::Text("%.2f", stats.p99);
+            ImGui::TableNextColumn();
+            if (zone.count == 0) continue;
+            // Oldest sample first; until the ring has wrapped it starts at 0
+            int offset = zone.count == historyFrames ? zone.next : 0;
+            ImGui::PushID(&zone);
+            ImGui::PlotLines("##History", zone.ms.data(), zone.count, offset, nullptr, 0.0f, stats.max,
+                ImVec2(-1.0f, 24.0f));
+            ImGui::PopID();
+        }
+        ImGui::EndTable();
+    }
+    ImGui::End();
+}
+
+bool Profiler::ExportCsv(const std::string& path) const {
+    std::ofstream file(path);
+    if (!file) return false;
+    file << "zone,type,frame,ms\n";
+    for (const Series& zone : series) {
+        int first = zone.count == historyFrames ? zone.next : 0;
+        for (int i = 0; i < zone.count; i++) {
+            int sample = (first + i) % historyFrames;
+            file << zone.name << ',' << (zone.gpu ? "gpu" : "cpu") << ',' << zone.frames[sample] << ','
+                << zone.ms[sample] << '\n';
+        }
+    }
+    return static_cast<bool>(file);
+}
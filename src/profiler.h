@@ -0,0 +1,88 @@
+#pragma once
+#include <chrono>
+#include <string>
+#include <vector>
+#include <glad/glad.h>
+
+// Per-frame times of named zones, CPU ones from a steady clock and GPU ones from GL_TIME_ELAPSED queries.
+// Each frame's queries go into a ring slot that is read when the ring comes back to it, queryFrames frames
+// later, so reading never waits on the GPU; a frame whose results still aren't in by then is dropped. A zone
+// timed more than once in a frame adds up. The last historyFrames samples of every zone are kept.
+class Profiler {
+public:
+    static const int historyFrames = 300;
+    static const int queryFrames = 3;
+
+    struct Stats {
+        float last = 0.0f;
+        float min = 0.0f;
+        float average = 0.0f;
+        float p99 = 0.0f;
+        float max = 0.0f;
+    };
+
+    void Destroy();
+    // Call at the start of every frame and once it's swapped
+    void BeginFrame();
+    void EndFrame();
+
+    // Only one GPU query can run at a time, so a GPU zone inside another is part of the outer one
+    void BeginGpu(const char* name);
+    void EndGpu();
+    void BeginCpu(const char* name);
+    void EndCpu();
+
+    // Window with the last, min, average and p99 time of each zone and a plot of its history
+    void DrawWindow(bool* open);
+    // One line per sample: zone, cpu or gpu, frame, milliseconds. False if the file can't be written.
+    bool ExportCsv(const std::string& path) const;
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    struct Series {
+        std::string name;
+        bool gpu = false;
+        std::vector<float> ms;         // ring of historyFrames samples
+        std::vector<long long> frames; // frame each sample was taken in
+        int next = 0;
+        int count = 0;
+        float pending = 0.0f;          // CPU time so far this frame
+        bool timed = false;
+
+        void Add(long long frame, float value);
+        Stats Compute() const;
+    };
+    struct FrameQueries {
+        std::vector<GLuint> pool;
+        std::vector<int> series; // of each query begun, in pool order
+        long long frame = -1;
+    };
+    struct OpenZone {
+        int series;
+        Clock::time_point start;
+    };
+
+    std::vector<Series> series;
+    FrameQueries queries[queryFrames];
+    std::vector<OpenZone> cpuZones;
+    int gpuDepth = 0;
+    long long frame = 0;
+    int droppedFrames = 0;
+    std::string exportMessage;
+
+    int FindSeries(const char* name, bool gpu);
+    void CollectQueries(FrameQueries& slot);
+};
+
+// Times the rest of the scope as a CPU zone
+class ProfileZone {
+public:
+    ProfileZone(Profiler& profiler, const char* name) : profiler(profiler) { profiler.BeginCpu(name); }
+    ~ProfileZone() { profiler.EndCpu(); }
+    ProfileZone(const ProfileZone&) = delete;
+    ProfileZone& operator=(const ProfileZone&) = delete;
+
+private:
+    Profiler& profiler;
+};
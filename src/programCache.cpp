@@ -0,0 +1,140 @@
+#include "programCache.h"
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+
+namespace {
+    // Not in the GL 3.3 headers glad was generated for
+    const GLenum programBinaryRetrievableHint = 0x8257;
+    const GLenum programBinaryLength = 0x8741;
+    const GLenum numProgramBinaryFormats = 0x87FE;
+
+    typedef void (APIENTRYP GetProgramBinaryProc)(GLuint program, GLsizei bufSize, GLsizei* length, GLenum* binaryFormat, void* binary);
+    typedef void (APIENTRYP ProgramBinaryProc)(GLuint program, GLenum binaryFormat, const void* binary, GLsizei length);
+    typedef void (APIENTRYP ProgramParameteriProc)(GLuint program, GLenum pname, GLint value);
+
+    GetProgramBinaryProc getProgramBinary = nullptr;
+    ProgramBinaryProc programBinary = nullptr;
+    ProgramParameteriProc programParameteri = nullptr;
+    bool supported = false;
+    int hits = 0;
+    int misses = 0;
+
+    const uint32_t entryMagic = 0x50424331; // "PBC1"
+
+    struct EntryHeader {
+        uint32_t magic;
+        uint32_t format;
+        uint64_t key;
+        uint64_t length;
+    };
+
+    uint64_t Fnv1a64(uint64_t hash, const std::string& data) {
+        for (unsigned char c : data) {
+            hash ^= c;
+            hash *= 1099511628211ull;
+        }
+        return hash;
+    }
+
+    std::string GlString(GLenum name) {
+        const GLubyte* value = glGetString(name);
+        return value ? reinterpret_cast<const char*>(value) : "";
+    }
+
+    std::filesystem::path EntryPath(const std::string& name) {
+        return std::filesystem::path(ProgramCache::directory) / (name + ".bin");
+    }
+}
+
+namespace ProgramCache {
+    void Init(GLADloadproc load) {
+        getProgramBinary = reinterpret_cast<GetProgramBinaryProc>(load("glGetProgramBinary"));
+        programBinary = reinterpret_cast<ProgramBinaryProc>(load("glProgramBinary"));
+        programParameteri = reinterpret_cast<ProgramParameteriProc>(load("glProgramParameteri"));
+        GLint formats = 0;
+        if (getProgramBinary && programBinary && programParameteri) glGetIntegerv(numProgramBinaryFormats, &formats);
+        // The query fails on drivers that don't know it, clear the error so it isn't reported as the first frame's
+        while (glGetError() != GL_NO_ERROR) {}
+        supported = formats > 0;
+        if (!supported) std::cout << "Program binaries not supported, shaders are compiled on every launch" << std::endl;
+    }
+
+    bool IsSupported() {
+        return supported;
+    }
+
+    uint64_t Key(const std::vector<std::string>& sources, const std::string& defines) {
+        uint64_t hash = 14695981039346656037ull;
+        for (const std::string& source : sources) hash = Fnv1a64(hash, source + '\0');
+        hash = Fnv1a64(hash, defines + '\0');
+        hash = Fnv1a64(hash, GlString(GL_VENDOR) + '\0');
+        hash = Fnv1a64(hash, GlString(GL_RENDERER) + '\0');
+        hash = Fnv1a64(hash, GlString(GL_VERSION));
+        return hash;
+    }
+
+    bool Load(GLuint program, const std::string& name, uint64_t key) {
+        if (!supported) {
+            misses++;
+            return false;
+        }
+        std::ifstream file(EntryPath(name), std::ios::binary);
+        EntryHeader header = {};
+        if (!file || !file.read(reinterpret_cast<char*>(&header), sizeof(header)) ||
+            header.magic != entryMagic || header.key != key) {
+            misses++;
+            return false;
+        }
+        std::vector<char> binary(static_cast<size_t>(header.length));
+        if (!file.read(binary.data(), static_cast<std::streamsize>(binary.size()))) {
+            misses++;
+            return false;
+        }
+
+        programBinary(program, header.format, binary.data(), static_cast<GLsizei>(binary.size()));
+        GLint linked = GL_FALSE;
+        glGetProgramiv(program, GL_LINK_STATUS, &linked);
+        if (!linked) {
+            // Same key but the driver changed under it
+            std::cout << "Program cache entry " << name << " was rejected, rebuilding it" << std::endl;
+            misses++;
+            return false;
+        }
+        hits++;
+        return true;
+    }
+
+    void PrepareForStore(GLuint program) {
+        if (supported) programParameteri(program, programBinaryRetrievableHint, GL_TRUE);
+    }
+
+    void Store(GLuint program, const std::string& name, uint64_t key) {
+        if (!supported) return;
+        GLint linked = GL_FALSE, length = 0;
+        glGetProgramiv(program, GL_LINK_STATUS, &linked);
+        glGetProgramiv(program, programBinaryLength, &length);
+        if (!linked || length <= 0) return;
+
+        std::vector<char> binary(static_cast<size_t>(length));
+        GLenum format = 0;
+        GLsizei written = 0;
+        getProgramBinary(program, length, &written, &format, binary.data());
+
+        std::error_code error;
+        std::filesystem::create_directories(directory, error);
+        std::ofstream file(EntryPath(name), std::ios::binary | std::ios::trunc);
+        EntryHeader header = { entryMagic, format, key, static_cast<uint64_t>(written) };
+        if (!file.write(reinterpret_cast<const char*>(&header), sizeof(header)) || !file.write(binary.data(), written)) {
+            std::cerr << "Could not write program cache entry " << EntryPath(name).string() << std::endl;
+        }
+    }
+
+    int GetHits() {
+        return hits;
+    }
+
+    int GetMisses() {
+        return misses;
+    }
+}
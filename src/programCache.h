@@ -0,0 +1,29 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <glad/glad.h>
+
+// Linked programs kept on disk with glGetProgramBinary, so later launches skip compiling them.
+// An entry holds one program, under a key made from its preprocessed sources, its defines and the
+// driver. When the key doesn't match or the driver rejects the binary the entry is stale and gets
+// rebuilt from source. Does nothing on drivers without program binaries (GL 4.1 or ARB_get_program_binary).
+namespace ProgramCache {
+    const char* const directory = "shaderCache/";
+
+    // Looks up the entry points glad leaves out, call once glad is loaded
+    void Init(GLADloadproc load);
+    bool IsSupported();
+
+    uint64_t Key(const std::vector<std::string>& sources, const std::string& defines);
+    // Links the program from the entry if it holds this key. False if it's missing, stale or rejected.
+    bool Load(GLuint program, const std::string& name, uint64_t key);
+    // Call before linking, so the driver keeps the binary around
+    void PrepareForStore(GLuint program);
+    // Writes the linked program to the entry, replacing whatever was there
+    void Store(GLuint program, const std::string& name, uint64_t key);
+
+    // Programs loaded from and compiled past the cache since launch
+    int GetHits();
+    int GetMisses();
+}
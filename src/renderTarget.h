@@ -0,0 +1,57 @@
+#pragma once
+#include <glad/glad.h>
+
+// Framebuffer with a color and a depth texture, for passes that read back what an earlier pass drew
+class RenderTarget {
+public:
+    RenderTarget() = default;
+    ~RenderTarget();
+    RenderTarget(const RenderTarget&) = delete;
+    RenderTarget& operator=(const RenderTarget&) = delete;
+
+    // Creates the textures, or recreates them if the size changed
+    bool Resize(int newWidth, int newHeight);
+    void Destroy();
+    // Draws into the target over its whole size
+    void Bind() const;
+
+    GLuint GetFramebuffer() const { return framebuffer; }
+    GLuint GetColorTexture() const { return colorTexture; }
+    GLuint GetDepthTexture() const { return depthTexture; }
+    int GetWidth() const { return width; }
+    int GetHeight() const { return height; }
+
+private:
+    GLuint framebuffer = 0;
+    GLuint colorTexture = 0; // RGBA16F, linear filtering
+    GLuint depthTexture = 0; // 24 bit depth, nearest filtering
+    int width = 0;
+    int height = 0;
+};
+
+// RGBA16F 3D texture drawn into a slice at a time, for volumes filled by full-screen passes
+class VolumeTarget {
+public:
+    VolumeTarget() = default;
+    ~VolumeTarget();
+    VolumeTarget(const VolumeTarget&) = delete;
+    VolumeTarget& operator=(const VolumeTarget&) = delete;
+
+    // Creates the texture, or recreates it if the size changed
+    bool Resize(int newWidth, int newHeight, int newDepth);
+    void Destroy();
+    // Draws into one slice over its whole size
+    void BindSlice(int slice) const;
+
+    GLuint GetTexture() const { return texture; }
+    int GetWidth() const { return width; }
+    int GetHeight() const { return height; }
+    int GetDepth() const { return depth; }
+
+private:
+    GLuint framebuffer = 0;
+    GLuint texture = 0; // linear filtering
+    int width = 0;
+    int height = 0;
+    int depth = 0;
+};
@@ -0,0 +1,171 @@
+#include "scatteringReference.h"
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include "threadPool.h"
+
+namespace {
+    // Ray and sphere around the planet center, like the helpers at the top of scattering.glsl
+    bool Intersects(const glm::dvec3& pos, const glm::dvec3& ray, double distance2, double radius2) {
+        double b = 2.0 * glm::dot(pos, ray);
+        double det = b * b - 4.0 * (distance2 - radius2);
+        if (det < 0.0) return false;
+        double sqrtDet = std::sqrt(det);
+        return 0.5 * (-b - sqrtDet) > 0.0 && 0.5 * (-b + sqrtDet) > 0.0;
+    }
+
+    double NearIntersection(const glm::dvec3& pos, const glm::dvec3& ray, double distance2, double radius2) {
+        double b = 2.0 * glm::dot(pos, ray);
+        return 0.5 * (-b - std::sqrt(std::max(0.0, b * b - 4.0 * (distance2 - radius2))));
+    }
+
+    double FarIntersection(const glm::dvec3& pos, const glm::dvec3& ray, double distance2, double radius2) {
+        double b = 2.0 * glm::dot(pos, ray);
+        return 0.5 * (-b + std::sqrt(std::max(0.0, b * b - 4.0 * (distance2 - radius2))));
+    }
+
+    double Density(const AtmosphereParams& params, const glm::dvec3& point) {
+        double height01 = (glm::length(point) - params.planetRadius) / (params.atmosphereRadius - params.planetRadius);
+        return std::exp(-height01 * params.densityFalloff / params.scaleDepth);
+    }
+
+    // The shader takes depthSamples points from the origin to the end of the ray and weights each by a whole step,
+    // the exact version the midpoints of depthSamples steps
+    double RayMarchedDepth(const ScatteringSettings& settings, const glm::dvec3& origin, const glm::dvec3& dir, double length) {
+        double stepSize = settings.matchShader ? length / (settings.depthSamples - 1) : length / settings.depthSamples;
+        double offset = settings.matchShader ? 0.0 : 0.5;
+        double depth = 0.0;
+        for (int i = 0; i < settings.depthSamples; i++) {
+            depth += Density(settings.params, origin + dir * ((i + offset) * stepSize)) * stepSize;
+        }
+        return depth;
+    }
+
+    double DepthToTop(const ScatteringSettings& settings, const glm::dvec3& point, const glm::dvec3& dir) {
+        const AtmosphereParams& params = settings.params;
+        double radius = glm::length(point);
+        float cosZenith = static_cast<float>(glm::dot(point, dir) / radius);
+        if (settings.opticalDepthMode == 1 && settings.transmittance) {
+            double thickness = params.atmosphereRadius - params.planetRadius;
+            return settings.transmittance->Sample(static_cast<float>((radius - params.planetRadius) / thickness), cosZenith) * thickness;
+        }
+        return ChapmanOpticalDepth(params, static_cast<float>(radius), cosZenith);
+    }
+}
+
+ScatteringRadiance IntegrateScattering(const ScatteringSettings& settings, const glm::dvec3& ray, double maxDistance) {
+    ScatteringRadiance radiance;
+    const AtmosphereParams& params = settings.params;
+    const glm::dvec3 camera(settings.cameraPos);
+    const double cameraHeight2 = glm::dot(camera, camera);
+    const double atmosphereRadius2 = static_cast<double>(params.atmosphereRadius) * params.atmosphereRadius;
+    const double planetRadius2 = static_cast<double>(params.planetRadius) * params.planetRadius;
+
+    // Rays that miss the atmosphere see none of it
+    double b = 2.0 * glm::dot(camera, ray);
+    if (b * b - 4.0 * (cameraHeight2 - atmosphereRadius2) < 0.0) return radiance;
+
+    double far = FarIntersection(camera, ray, cameraHeight2, atmosphereRadius2);
+    if (Intersects(camera, ray, cameraHeight2, planetRadius2)) {
+        far = NearIntersection(camera, ray, cameraHeight2, planetRadius2);
+    }
+    far = std::min(far, maxDistance);
+    double near = std::max(NearIntersection(camera, ray, cameraHeight2, atmosphereRadius2), 0.0);
+    if (far <= near) return radiance;
+    glm::dvec3 start = camera + ray * near;
+
+    double stepSize = std::abs(far - near) / settings.samples;
+    glm::dvec3 sampleRay = ray * stepSize;
+    bool startOnRay = settings.matchShader && std::sqrt(cameraHeight2) < params.atmosphereRadius;
+    glm::dvec3 samplePoint = startOnRay ? start : start + sampleRay * 0.5;
+    bool rayMarched = settings.opticalDepthMode == 0;
+    double startDepthForward = rayMarched ? 0.0 : DepthToTop(settings, start, ray);
+    double startDepthBackward = rayMarched ? 0.0 : DepthToTop(settings, start, -ray);
+
+    const glm::dvec3 sunDir = glm::normalize(glm::dvec3(settings.lightPos));
+    const glm::dvec3 invWavelength4(settings.invWavelength4);
+    const double thickness = params.atmosphereRadius - params.planetRadius;
+    // All three channels go through each step together
+    glm::dvec3 frontColor(0.0), multiColor(0.0);
+    for (int i = 0; i < settings.samples; i++) {
+        // The shader nudges the point towards the sun in case it sits on the surface, the nudges add up along the ray
+        glm::dvec3 nudge = settings.matchShader ? sunDir * 0.001 : glm::dvec3(0.0);
+        samplePoint += nudge;
+        double sunDepth, viewDepth;
+        if (rayMarched) {
+            double sunRayLength = FarIntersection(samplePoint, sunDir, glm::dot(samplePoint, samplePoint), atmosphereRadius2);
+            sunDepth = RayMarchedDepth(settings, samplePoint, sunDir, sunRayLength);
+            viewDepth = RayMarchedDepth(settings, samplePoint, -ray, glm::length(samplePoint - camera) - near);
+        } else {
+            sunDepth = DepthToTop(settings, samplePoint, sunDir);
+            viewDepth = glm::dot(samplePoint, ray) >= 0.0 ?
+                startDepthForward - DepthToTop(settings, samplePoint, ray) :
+                DepthToTop(settings, samplePoint, -ray) - startDepthBackward;
+            viewDepth = std::max(viewDepth, 0.0);
+        }
+
+        glm::dvec3 transmittance = glm::exp(-(sunDepth + viewDepth) * invWavelength4);
+        double density = Density(params, samplePoint);
+        frontColor += density * stepSize * transmittance * invWavelength4;
+        if (settings.multiScattering) {
+            double radius = glm::length(samplePoint);
+            glm::dvec3 multi(settings.multiScattering->Sample(static_cast<float>((radius - params.planetRadius) / thickness),
+                static_cast<float>(glm::dot(samplePoint, sunDir) / radius)));
+            multiColor += density * stepSize * glm::exp(-viewDepth * invWavelength4) * invWavelength4 * multi;
+        }
+        samplePoint += sampleRay + (settings.matchShader ? glm::dvec3(0.0) : -nudge);
+    }
+
+    const glm::dvec3 lightColor(settings.lightColor);
+    radiance.mie = static_cast<double>(settings.kMieSunBrightness) * frontColor * lightColor;
+    radiance.rayleigh = static_cast<double>(settings.kRayleighSunBrightness) * frontColor * lightColor * invWavelength4;
+    radiance.multi = (static_cast<double>(settings.kRayleighSunBrightness) * invWavelength4 + glm::dvec3(settings.kMieSunBrightness)) *
+        multiColor * lightColor;
+    return radiance;
+}
+
+glm::dvec3 ScatteredLight(const ScatteringSettings& settings, const glm::dvec3& ray, double maxDistance) {
+    ScatteringRadiance radiance = IntegrateScattering(settings, ray, maxDistance);
+    double g = settings.gMie, g2 = g * g;
+    double cosAngle = glm::dot(glm::normalize(glm::dvec3(settings.lightPos)), -ray);
+    double cos2 = cosAngle * cosAngle;
+    double miePhase = 1.5 * ((1.0 - g2) / (2.0 + g2)) * (1.0 + cos2) / std::pow(1.0 + g2 - 2.0 * g * cosAngle, 1.5);
+    double rayleighPhase = 0.75 * (1.0 + cos2);
+    return radiance.rayleigh * rayleighPhase + radiance.mie * miePhase + radiance.multi;
+}
+
+std::vector<glm::vec3> RenderScattering(const ScatteringSettings& settings, const glm::mat4& inverseViewProjection, int width, int height) {
+    std::vector<glm::vec3> pixels(static_cast<size_t>(width) * height);
+    const glm::dvec3 camera(settings.cameraPos);
+    ThreadPool::Shared().ParallelFor(height, [&](int y) {
+        for (int x = 0; x < width; x++) {
+            glm::vec4 farPoint = inverseViewProjection *
+                glm::vec4((x + 0.5f) / width * 2.0f - 1.0f, (y + 0.5f) / height * 2.0f - 1.0f, 1.0f, 1.0f);
+            glm::dvec3 ray = glm::normalize(glm::dvec3(glm::vec3(farPoint) / farPoint.w) - camera);
+            glm::dvec3 color = 1.0 - glm::exp(-ScatteredLight(settings, ray) * static_cast<double>(settings.exposure));
+            pixels[static_cast<size_t>(y) * width + x] = glm::vec3(color);
+        }
+    });
+    return pixels;
+}
+
+bool WritePpm(const std::string& path, const std::vector<glm::vec3>& pixels, int width, int height) {
+    std::ofstream out(path, std::ios::binary);
+    if (!out) {
+        std::cerr << "Failed to open " << path << " for writing" << std::endl;
+        return false;
+    }
+    out << "P6\n" << width << " " << height << "\n255\n";
+    std::vector<unsigned char> row(static_cast<size_t>(width) * 3);
+    for (int y = height - 1; y >= 0; y--) {
+        for (int x = 0; x < width; x++) {
+            const glm::vec3& pixel = pixels[static_cast<size_t>(y) * width + x];
+            for (int c = 0; c < 3; c++) {
+                row[x * 3 + c] = static_cast<unsigned char>(std::clamp(pixel[c], 0.0f, 1.0f) * 255.0f + 0.5f);
+            }
+        }
+        out.write(reinterpret_cast<const char*>(row.data()), row.size());
+    }
+    return static_cast<bool>(out);
+}
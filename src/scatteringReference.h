@@ -0,0 +1,45 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <glm/glm.hpp>
+#include "atmosphereLut.h"
+
+// CPU mirror of integrateScattering and scatteredLight in scattering.glsl, in double precision and at any
+// sample count, to tune nSamples, depthSamples and the optical depth approximations against. Keep in sync.
+struct ScatteringSettings {
+    AtmosphereParams params;
+    glm::vec3 cameraPos = glm::vec3(0.0f, 0.0f, -10.0f);
+    glm::vec3 lightPos = glm::vec3(0.0f, 100.0f, -600.0f);
+    glm::vec3 lightColor = glm::vec3(1.0f);
+    glm::vec3 invWavelength4 = glm::vec3(1.0f);
+    float kRayleighSunBrightness = 0.0f;
+    float kMieSunBrightness = 0.0f;
+    float gMie = -0.99f;
+    float exposure = 2.0f;
+    int samples = 16;         // nSamples
+    int depthSamples = 10;    // steps of the ray marched optical depths
+    int opticalDepthMode = 0; // like the shader, the LUT mode falls back to the Chapman function without a LUT
+    // Off drops the shader's shortcuts so the result converges on the true integral as the sample counts go up:
+    // the nudges towards the sun adding up along the ray, the extra step of the ray marched depths and the first
+    // sample sitting on the start of the ray from inside the atmosphere
+    bool matchShader = true;
+    const TransmittanceLut* transmittance = nullptr;
+    const MultiScatteringLut* multiScattering = nullptr; // multiple scattering is added when set
+};
+
+// Light scattered towards the camera along a ray, before the phase functions
+struct ScatteringRadiance {
+    glm::dvec3 rayleigh = glm::dvec3(0.0);
+    glm::dvec3 mie = glm::dvec3(0.0);
+    glm::dvec3 multi = glm::dvec3(0.0);
+};
+
+// Along a normalized ray from the camera, up to maxDistance away
+ScatteringRadiance IntegrateScattering(const ScatteringSettings& settings, const glm::dvec3& ray, double maxDistance = 1e30);
+// Same with the phase functions applied
+glm::dvec3 ScatteredLight(const ScatteringSettings& settings, const glm::dvec3& ray, double maxDistance = 1e30);
+// The atmosphere over a whole view with nothing behind it, tone mapped like atmosphere.frag.
+// Rows go bottom up like OpenGL and are spread over the thread pool.
+std::vector<glm::vec3> RenderScattering(const ScatteringSettings& settings, const glm::mat4& inverseViewProjection, int width, int height);
+// Binary PPM of bottom up rows like RenderScattering's
+bool WritePpm(const std::string& path, const std::vector<glm::vec3>& pixels, int width, int height);
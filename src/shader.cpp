@@ -1,77 +1,244 @@
 #include "shader.h"
-#include <fstream>
-#include <sstream>
+#include "parameterStore.h"
+#include "programCache.h"
+#include "uniformBuffers.h"
+#include "glState.h"
+#include <cstdio>
 #include <iostream>
-#include <regex>
-#include <glm/gtc/type_ptr.hpp>
-
-Shader::Shader(const char* vertexPath, const char* fragmentPath, const char* geometryPath ) {
-    // 1. Read shader source files
-    std::ifstream vFile(vertexPath), fFile(fragmentPath);
-    std::stringstream vStream, fStream;
-    
-    vStream << vFile.rdbuf();
-    fStream << fFile.rdbuf();
-    
-    std::string vCode = PreprocessShader(vStream.str(), "shaders/");
-    std::string fCode = PreprocessShader(fStream.str(), "shaders/");
-    
-    const char* vShaderCode = vCode.c_str();
-    const char* fShaderCode = fCode.c_str();
-
-    // 2. Compile vertex shader
-    unsigned int vertex = glCreateShader(GL_VERTEX_SHADER);
-    glShaderSource(vertex, 1, &vShaderCode, NULL);
-    glCompileShader(vertex);
-    CheckCompileErrors(vertex, "VERTEX");
-
-    // 3. Compile fragment shader
-    unsigned int fragment = glCreateShader(GL_FRAGMENT_SHADER);
-    glShaderSource(fragment, 1, &fShaderCode, NULL);
-    glCompileShader(fragment);
-    CheckCompileErrors(fragment, "FRAGMENT");
-
-    // 4. Optional geometry shader
-    unsigned int geometry = 0;
-    if (geometryPath != nullptr) {
-        std::ifstream gFile(geometryPath);
-        std::stringstream gStream;
-        gStream << gFile.rdbuf();
-        std::string gCode = PreprocessShader(gStream.str(), "shaders/");
-        const char* gShaderCode = gCode.c_str();
-
-        geometry = glCreateShader(GL_GEOMETRY_SHADER);
-        glShaderSource(geometry, 1, &gShaderCode, NULL);
-        glCompileShader(geometry);
-        CheckCompileErrors(geometry, "GEOMETRY");
-    }
-
-    // 5. Create shader program
-    ID = glCreateProgram();
-    glAttachShader(ID, vertex);
-    if (geometryPath != nullptr) {
-        glAttachShader(ID, geometry);
-    }
-    glAttachShader(ID, fragment);
-    glLinkProgram(ID);
-    CheckCompileErrors(ID, "PROGRAM");
-
-    // 6. Cleanup shaders
-    glDeleteShader(vertex);
-    glDeleteShader(fragment);
-    if (geometryPath != nullptr) {
-        glDeleteShader(geometry);
-    }
-}
-
-void Shader::CheckCompileErrors(GLuint shader, std::string type) {
+#include <filesystem>
+#include <algorithm>
+#include <unordered_map>
+
+Shader::Shader(const char* vertexPath, const char* fragmentPath, const char* geometryPath)
+    : Shader(vertexPath, fragmentPath, geometryPath, "") {}
+
+Shader::Shader(const char* vertexPath, const char* fragmentPath, const char* geometryPath, const std::string& defines, bool wait)
+    : ID(0), vertexPath(vertexPath), fragmentPath(fragmentPath), geometryPath(geometryPath != nullptr ? geometryPath : ""),
+    defines(defines) {
+    cacheName = std::filesystem::path(vertexPath).filename().string() + "+" +
+        std::filesystem::path(fragmentPath).filename().string();
+    if (geometryPath != nullptr) cacheName += "+" + std::filesystem::path(geometryPath).filename().string();
+    // Each permutation keeps its own cache entry
+    if (!defines.empty()) {
+        char suffix[16];
+        std::snprintf(suffix, sizeof(suffix), "@%08x", UniformHash(defines));
+        cacheName += suffix;
+    }
+
+    pending = StartBuild();
+    if (wait) FinishReload();
+}
+
+Shader* Shader::CreatePermutation(const std::string& defines) const {
+    return new Shader(vertexPath.c_str(), fragmentPath.c_str(), geometryPath.empty() ? nullptr : geometryPath.c_str(), defines, false);
+}
+
+Shader::~Shader() {
+    CancelReload();
+    glDeleteProgram(ID);
+}
+
+// Reads the files and expands their includes, then links the program from the cache or hands the
+// stages to the driver. Nothing here waits for the compile, FinishBuild does.
+Shader::Build Shader::StartBuild() {
+    ShaderPreprocessor& preprocessor = ShaderPreprocessor::Shared();
+    Build build;
+    build.stages.push_back({ GL_VERTEX_SHADER, preprocessor.Process(vertexPath) });
+    if (!geometryPath.empty()) build.stages.push_back({ GL_GEOMETRY_SHADER, preprocessor.Process(geometryPath) });
+    build.stages.push_back({ GL_FRAGMENT_SHADER, preprocessor.Process(fragmentPath) });
+    if (!defines.empty()) {
+        // Right after #version, then back to numbering the root file from its second line
+        for (Stage& stage : build.stages) {
+            std::string& source = stage.code.source;
+            size_t versionEnd = source.compare(0, 8, "#version") == 0 ? source.find('\n') + 1 : 0;
+            source.insert(versionEnd, defines + (versionEnd > 0 ? "#line 2 0\n" : "#line 1 0\n"));
+        }
+    }
+
+    // A program linked from the same sources on this driver before is taken from the cache
+    const std::string noGeometry;
+    build.cacheKey = ProgramCache::Key({ build.stages.front().code.source,
+        geometryPath.empty() ? noGeometry : build.stages[1].code.source, build.stages.back().code.source }, defines);
+    build.program = glCreateProgram();
+    if (ProgramCache::Load(build.program, cacheName, build.cacheKey)) {
+        build.cached = true;
+        return build;
+    }
+
+    for (Stage& stage : build.stages) {
+        const char* code = stage.code.source.c_str();
+        stage.shader = glCreateShader(stage.type);
+        glShaderSource(stage.shader, 1, &code, NULL);
+        glCompileShader(stage.shader);
+        glAttachShader(build.program, stage.shader);
+    }
+    ProgramCache::PrepareForStore(build.program);
+    glLinkProgram(build.program);
+    return build;
+}
+
+// Reports compile and link errors, frees the stages and stores a program that linked in the cache
+bool Shader::FinishBuild(Build& build) {
+    if (build.cached) return true;
+
+    bool ok = true;
+    for (const Stage& stage : build.stages) {
+        const char* type = stage.type == GL_VERTEX_SHADER ? "VERTEX" : stage.type == GL_GEOMETRY_SHADER ? "GEOMETRY" : "FRAGMENT";
+        if (!CheckCompileErrors(stage.shader, type)) {
+            PrintSourceFiles(stage.code);
+            ok = false;
+        }
+    }
+    ok = CheckCompileErrors(build.program, "PROGRAM") && ok;
+
+    for (Stage& stage : build.stages) {
+        glDetachShader(build.program, stage.shader);
+        glDeleteShader(stage.shader);
+        stage.shader = 0;
+    }
+    if (ok) ProgramCache::Store(build.program, cacheName, build.cacheKey);
+    return ok;
+}
+
+bool Shader::StartReload() {
+    CancelReload();
+    try {
+        pending = StartBuild();
+    }
+    catch (const std::runtime_error& e) {
+        std::cerr << "Not reloading " << cacheName << ": " << e.what() << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool Shader::IsReloading() const {
+    return pending.program != 0;
+}
+
+GLuint Shader::GetPendingProgram() const {
+    return pending.program;
+}
+
+bool Shader::FinishReload() {
+    if (pending.program == 0) return false;
+    Build build = std::move(pending);
+    pending = Build();
+    // Even a build that fails counts, fixing any of its files tries again
+    sourceFiles.clear();
+    for (const Stage& stage : build.stages) {
+        for (const std::string& file : stage.code.files) {
+            if (std::find(sourceFiles.begin(), sourceFiles.end(), file) == sourceFiles.end()) sourceFiles.push_back(file);
+        }
+    }
+    if (!FinishBuild(build)) {
+        if (ID != 0) std::cerr << "Keeping the previous program of " << cacheName << std::endl;
+        glDeleteProgram(build.program);
+        return false;
+    }
+
+    GLuint previous = ID;
+    ID = build.program;
+    BindUniformBlocks();
+    CacheUniformLocations();
+    if (previous != 0) {
+        CopyUniformsFrom(previous);
+        glDeleteProgram(previous);
+    }
+    // Locations moved, the next Upload sends every stored parameter again
+    uploadedStore = nullptr;
+    return true;
+}
+
+void Shader::CancelReload() {
+    if (pending.program == 0) return;
+    for (Stage& stage : pending.stages) {
+        if (stage.shader != 0) glDeleteShader(stage.shader);
+    }
+    glDeleteProgram(pending.program);
+    pending = Build();
+}
+
+// Values set once after creating a shader (sampler units, sizes) live in the program object,
+// the new program gets them from the old one. GL 3.3 only sets uniforms of the program in use.
+void Shader::CopyUniformsFrom(GLuint program) {
+    GLuint current = GLState::GetProgram();
+    GLState::UseProgram(ID);
+
+    // Active uniforms of a program by name, arrays without the [0]
+    auto activeUniforms = [](GLuint of) {
+        std::unordered_map<std::string, std::pair<GLenum, GLint>> active;
+        GLint count = 0, maxLength = 0;
+        glGetProgramiv(of, GL_ACTIVE_UNIFORMS, &count);
+        glGetProgramiv(of, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLength);
+        std::vector<GLchar> buffer(std::max(maxLength, 1));
+        for (GLint i = 0; i < count; i++) {
+            GLsizei length = 0;
+            GLint size = 0;
+            GLenum type = 0;
+            glGetActiveUniform(of, i, static_cast<GLsizei>(buffer.size()), &length, &size, &type, buffer.data());
+            std::string name(buffer.data(), length);
+            if (name.size() > 3 && name.compare(name.size() - 3, 3, "[0]") == 0) name.resize(name.size() - 3);
+            active[name] = { type, size };
+        }
+        return active;
+    };
+    auto previous = activeUniforms(program);
+    for (const auto& [name, uniform] : activeUniforms(ID)) {
+        auto found = previous.find(name);
+        // Declarations that changed type start over from zero
+        if (found == previous.end() || found->second.first != uniform.first) continue;
+        GLenum type = uniform.first;
+        GLint size = std::min(uniform.second, found->second.second);
+        for (GLint element = 0; element < size; element++) {
+            std::string elementName = uniform.second > 1 ? name + "[" + std::to_string(element) + "]" : name;
+            GLint from = glGetUniformLocation(program, elementName.c_str());
+            GLint to = glGetUniformLocation(ID, elementName.c_str());
+            if (from < 0 || to < 0) continue; // block members have no location
+            GLfloat f[16];
+            GLint n[4];
+            switch (type) {
+            case GL_FLOAT: glGetUniformfv(program, from, f); glUniform1fv(to, 1, f); break;
+            case GL_FLOAT_VEC2: glGetUniformfv(program, from, f); glUniform2fv(to, 1, f); break;
+            case GL_FLOAT_VEC3: glGetUniformfv(program, from, f); glUniform3fv(to, 1, f); break;
+            case GL_FLOAT_VEC4: glGetUniformfv(program, from, f); glUniform4fv(to, 1, f); break;
+            case GL_FLOAT_MAT3: glGetUniformfv(program, from, f); glUniformMatrix3fv(to, 1, GL_FALSE, f); break;
+            case GL_FLOAT_MAT4: glGetUniformfv(program, from, f); glUniformMatrix4fv(to, 1, GL_FALSE, f); break;
+            case GL_INT_VEC2: glGetUniformiv(program, from, n); glUniform2iv(to, 1, n); break;
+            case GL_INT_VEC3: glGetUniformiv(program, from, n); glUniform3iv(to, 1, n); break;
+            case GL_INT:
+            case GL_BOOL:
+            case GL_SAMPLER_2D:
+            case GL_SAMPLER_3D:
+            case GL_SAMPLER_CUBE:
+            case GL_SAMPLER_2D_ARRAY:
+            case GL_SAMPLER_BUFFER:
+            case GL_INT_SAMPLER_2D:
+            case GL_INT_SAMPLER_3D:
+            case GL_INT_SAMPLER_CUBE:
+            case GL_INT_SAMPLER_BUFFER:
+            case GL_UNSIGNED_INT_SAMPLER_2D:
+            case GL_UNSIGNED_INT_SAMPLER_BUFFER:
+                glGetUniformiv(program, from, n);
+                glUniform1iv(to, 1, n);
+                break;
+            default: break;
+            }
+        }
+    }
+    GLState::UseProgram(current);
+}
+
+bool Shader::CheckCompileErrors(GLuint shader, std::string type) {
     GLint success;
+    bool ok = true;
     GLchar infoLog[1024];
 
     if (type != "PROGRAM") {
         // Check shader compilation errors
         glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
         if (!success) {
+            ok = false;
             glGetShaderInfoLog(shader, 1024, NULL, infoLog);
             std::cerr << "ERROR::SHADER_COMPILATION_ERROR of type: " << type << "\n"
                 << infoLog << "\n"
@@ -82,6 +249,7 @@ void Shader::CheckCompileErrors(GLuint shader, std::string type) {
         // Check program linking errors
         glGetProgramiv(shader, GL_LINK_STATUS, &success);
         if (!success) {
+            ok = false;
             glGetProgramInfoLog(shader, 1024, NULL, infoLog);
             std::cerr << "ERROR::PROGRAM_LINKING_ERROR of type: " << type << "\n"
                 << infoLog << "\n"
@@ -98,54 +266,160 @@ void Shader::CheckCompileErrors(GLuint shader, std::string type) {
                 << "-------------------------------------------------------" << std::endl;
         }
     }
+    return ok;
 }
 
+// Errors are reported as source string(line), the strings are numbered by the #line directives of the preprocessor
+void Shader::PrintSourceFiles(const ShaderPreprocessor::Result& code) {
+    for (size_t i = 0; i < code.files.size(); i++) {
+        std::cerr << "  " << i << ": " << code.files[i] << "\n";
+    }
+    std::cerr << std::flush;
+}
+
+// Shared blocks go to their binding points, GLSL 330 can't say so in the shader
+void Shader::BindUniformBlocks() {
+    GLint count = 0, maxLength = 0;
+    glGetProgramiv(ID, GL_ACTIVE_UNIFORM_BLOCKS, &count);
+    glGetProgramiv(ID, GL_ACTIVE_UNIFORM_BLOCK_MAX_NAME_LENGTH, &maxLength);
+    std::vector<GLchar> buffer(std::max(maxLength, 1));
+    for (GLint i = 0; i < count; i++) {
+        GLsizei length = 0;
+        glGetActiveUniformBlockName(ID, i, static_cast<GLsizei>(buffer.size()), &length, buffer.data());
+        int binding = UniformBlockBinding(std::string_view(buffer.data(), length));
+        if (binding < 0) {
+            std::cerr << "Uniform block " << std::string(buffer.data(), length) << " has no binding point" << std::endl;
+            continue;
+        }
+        glUniformBlockBinding(ID, i, binding);
+    }
+}
+
+// The only place locations come from the driver, every setter after this is a binary search
+void Shader::CacheUniformLocations() {
+    uniforms.clear();
+    GLint count = 0, maxLength = 0;
+    glGetProgramiv(ID, GL_ACTIVE_UNIFORMS, &count);
+    glGetProgramiv(ID, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLength);
+    std::vector<GLchar> buffer(std::max(maxLength, 1));
+
+    auto add = [&](const std::string& name) {
+        GLint location = glGetUniformLocation(ID, name.c_str());
+        if (location >= 0) uniforms.push_back({ UniformHash(name), location });
+    };
+    for (GLint i = 0; i < count; i++) {
+        GLsizei length = 0;
+        GLint size = 0;
+        GLenum type = 0;
+        glGetActiveUniform(ID, i, static_cast<GLsizei>(buffer.size()), &length, &size, &type, buffer.data());
+        std::string name(buffer.data(), length);
+        // Arrays are listed once as "name[0]", every element gets its own entry and "name" points at the first
+        if (size > 1 && name.size() > 3 && name.compare(name.size() - 3, 3, "[0]") == 0) {
+            std::string base = name.substr(0, name.size() - 3);
+            add(base);
+            for (GLint element = 0; element < size; element++) {
+                add(base + "[" + std::to_string(element) + "]");
+            }
+        }
+        else {
+            add(name);
+        }
+    }
+
+    std::sort(uniforms.begin(), uniforms.end(), [](const UniformSlot& a, const UniformSlot& b) { return a.hash < b.hash; });
+    for (size_t i = 1; i < uniforms.size(); i++) {
+        if (uniforms[i].hash == uniforms[i - 1].hash && uniforms[i].location != uniforms[i - 1].location) {
+            std::cerr << "Two uniforms of program " << ID << " have the same name hash " << uniforms[i].hash << std::endl;
+        }
+    }
+}
+
+GLint Shader::Location(UniformId name) const {
+    return LocationOfHash(name.hash);
+}
+
+GLint Shader::LocationOfHash(uint32_t hash) const {
+    auto slot = std::lower_bound(uniforms.begin(), uniforms.end(), hash,
+        [](const UniformSlot& a, uint32_t hash) { return a.hash < hash; });
+    return slot != uniforms.end() && slot->hash == hash ? slot->location : -1;
+}
+
+int Shader::Upload(const ParameterStore& store) {
+    if (&store != uploadedStore) {
+        uploadedStore = &store;
+        uploadedStoreVersion = 0;
+        parameterLocations.clear();
+        uploadedVersions.clear();
+    }
+    const std::vector<ParameterStore::Parameter>& parameters = store.GetParameters();
+    if (store.GetVersion() == uploadedStoreVersion) {
+        uniformUploadStats.skipped += static_cast<int>(parameters.size());
+        return 0;
+    }
+    // Parameters set for the first time since the last upload
+    while (parameterLocations.size() < parameters.size()) {
+        parameterLocations.push_back(LocationOfHash(parameters[parameterLocations.size()].nameHash));
+        uploadedVersions.push_back(0);
+    }
+
+    int uploads = 0;
+    for (size_t i = 0; i < parameters.size(); i++) {
+        if (parameterLocations[i] < 0) continue;
+        if (uploadedVersions[i] == parameters[i].version) {
+            uniformUploadStats.skipped++;
+            continue;
+        }
+        std::visit([&](const auto& value) { SetUniform(parameterLocations[i], value); }, parameters[i].value);
+        uploadedVersions[i] = parameters[i].version;
+        uploads++;
+    }
+    uploadedStoreVersion = store.GetVersion();
+    return uploads;
+}
 
 void Shader::enable() {
-    glUseProgram(ID);
+    GLState::UseProgram(ID);
 }
+// Leaves the program bound, the next pass's enable replaces it. Unbinding after every pass only cost driver calls.
 void Shader::disable() {
-    glUseProgram(0);
 }
 
-void Shader::setVec3(const std::string& name, const glm::vec3& value) const {
-    glUniform3fv(glGetUniformLocation(ID, name.c_str()), 1, glm::value_ptr(value));
+void Shader::setVec2(UniformId name, const glm::vec2& value) const {
+    SetUniform(Location(name), value);
 }
 
-void Shader::setVec3(const std::string& name, float x, float y, float z) const {
-    glUniform3f(glGetUniformLocation(ID, name.c_str()), x, y, z);
+void Shader::setVec3(UniformId name, const glm::vec3& value) const {
+    SetUniform(Location(name), value);
 }
 
-void Shader::setMat4(const std::string& name, const glm::mat4& mat) const {
-    glUniformMatrix4fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, glm::value_ptr(mat));
+void Shader::setVec3(UniformId name, float x, float y, float z) const {
+    SetUniform(Location(name), glm::vec3(x, y, z));
 }
 
-void Shader::setFloat(const std::string& name, float value) const {
-    glUniform1f(glGetUniformLocation(ID, name.c_str()), value);
+void Shader::setMat4(UniformId name, const glm::mat4& mat) const {
+    SetUniform(Location(name), mat);
 }
 
-void Shader::setInt(const std::string& name, int value) const {
-    glUniform1i(glGetUniformLocation(ID, name.c_str()), value);
+void Shader::setFloat(UniformId name, float value) const {
+    SetUniform(Location(name), value);
 }
 
-void Shader::setBool(const std::string& name, bool value) const {
-    glUniform1i(glGetUniformLocation(ID, name.c_str()), value);
+void Shader::setInt(UniformId name, int value) const {
+    SetUniform(Location(name), value);
 }
 
-std::string Shader::PreprocessShader(const std::string& source, const std::string& includePath) {
-    std::regex includeRegex(R"(#include\s+\"([^\"]+)\")");
-    std::smatch matches;
-    std::string result = source;
+void Shader::setBool(UniformId name, bool value) const {
+    SetUniform(Location(name), value);
+}
 
-    while (std::regex_search(result, matches, includeRegex)) {
-        std::string includeFile = includePath + matches[1].str();
-        std::ifstream file(includeFile);
-        if (!file.is_open()) {
-            throw std::runtime_error("Could not open include file: " + includeFile);
-        }
-        std::string content((std::istreambuf_iterator<char>(file)),
-            std::istreambuf_iterator<char>());
-        result.replace(matches.position(), matches.length(), content);
-    }
-    return result;
+const std::string& Shader::GetName() const {
+    return cacheName;
+}
+
+const std::string& Shader::GetDefines() const {
+    return defines;
+}
+
+const std::vector<std::string>& Shader::GetSourceFiles() const {
+    return sourceFiles;
 }
@@ -1,25 +1,179 @@
 #pragma once
+#include <cstdint>
 #include <string>
+#include <string_view>
+#include <vector>
 #include <glm/glm.hpp>
 #include <glad/glad.h>
+#include "shaderPreprocessor.h"
+
+// 32 bit FNV-1a of a uniform name
+constexpr uint32_t UniformHash(std::string_view name) {
+    uint32_t hash = 2166136261u;
+    for (char c : name) {
+        hash ^= static_cast<unsigned char>(c);
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+// A uniform name by its hash. Literal names are hashed at compile time, a constexpr UniformId makes sure of it.
+struct UniformId {
+    uint32_t hash;
+
+    constexpr UniformId(std::string_view name) : hash(UniformHash(name)) {}
+    constexpr UniformId(const char* name) : UniformId(std::string_view(name)) {}
+    UniformId(const std::string& name) : UniformId(std::string_view(name)) {}
+};
+
+class ParameterStore;
+
+// What reached the driver, reset every frame for the HUD
+struct UniformUploadStats {
+    int uniforms = 0;    // glUniform calls
+    int skipped = 0;     // stored parameters a program already had
+    int blocks = 0;      // uniform buffer uploads
+    int blockBytes = 0;
+};
+inline UniformUploadStats uniformUploadStats;
 
 class Shader {
 public:
     unsigned int ID;
 
     Shader(const char* vertexPath, const char* fragmentPath, const char* geometryPath = nullptr);
-    void CheckCompileErrors(GLuint shader, std::string type);
+    // A permutation: the same files with #define lines put after #version. Unless wait is set the driver is left to
+    // build it like a reload, ID stays 0 until FinishReload.
+    Shader(const char* vertexPath, const char* fragmentPath, const char* geometryPath, const std::string& defines, bool wait = true);
+    // The same files with other defines, left to the driver to build
+    Shader* CreatePermutation(const std::string& defines) const;
+    ~Shader();
+    Shader(const Shader&) = delete;
+    Shader& operator=(const Shader&) = delete;
+
+    // Prints the log and returns false if compiling or linking failed
+    bool CheckCompileErrors(GLuint shader, std::string type);
     void enable();
     void disable();
 
-    void setVec3(const std::string& name, const glm::vec3& value) const;
-    void setVec3(const std::string& name, float x, float y, float z) const;
+    // Location of an active uniform, looked up in the table built after linking. -1 if the program doesn't use it.
+    GLint Location(UniformId name) const;
+
+    void setVec2(UniformId name, const glm::vec2& value) const;
+    void setVec3(UniformId name, const glm::vec3& value) const;
+    void setVec3(UniformId name, float x, float y, float z) const;
+
+    void setMat4(UniformId name, const glm::mat4& mat) const;
+    void setFloat(UniformId name, float value) const;
+    void setInt(UniformId name, int value) const;
+    void setBool(UniformId name, bool value) const;
+
+    // Uploads the stored parameters this program declares whose version it hasn't seen, needs the program in use.
+    // Returns how many were uploaded.
+    int Upload(const ParameterStore& store);
 
-    void setMat4(const std::string& name, const glm::mat4& mat) const;
-    void setFloat(const std::string& name, float value) const;
-    void setInt(const std::string& name, int value) const;
-    void setBool(const std::string& name, bool value) const;
+    // The stage file names, also the program's name in the cache
+    const std::string& GetName() const;
+    const std::string& GetDefines() const;
+    // Every file the program was built from, includes too
+    const std::vector<std::string>& GetSourceFiles() const;
+
+    // Hot reload: builds the program again from its files while the current one stays in use. Starting again
+    // drops a reload still under way. False if the files couldn't be read.
+    bool StartReload();
+    bool IsReloading() const;
+    GLuint GetPendingProgram() const;
+    // Waits for the driver if it isn't done. True if the new program linked and replaced the old one, which
+    // hands its uniform values over first.
+    bool FinishReload();
+    void CancelReload();
+    // Takes the values of every uniform both programs declare the same way, for the ones set once after creating
+    void CopyUniformsFrom(GLuint program);
+
+private:
+    struct UniformSlot {
+        uint32_t hash;
+        GLint location;
+    };
+    std::vector<UniformSlot> uniforms; // sorted by hash
+
+    // Per parameter of the last store uploaded from: its location here and the version uploaded
+    const ParameterStore* uploadedStore = nullptr;
+    uint64_t uploadedStoreVersion = 0;
+    std::vector<GLint> parameterLocations;
+    std::vector<uint64_t> uploadedVersions;
+
+    GLint LocationOfHash(uint32_t hash) const;
+
+    // A program being compiled and linked, the driver may still be working on it
+    struct Stage {
+        GLenum type;
+        ShaderPreprocessor::Result code;
+        GLuint shader = 0;
+    };
+    struct Build {
+        GLuint program = 0;
+        uint64_t cacheKey = 0;
+        bool cached = false; // linked from the program cache, nothing to compile
+        std::vector<Stage> stages;
+    };
+
+    std::string vertexPath, fragmentPath, geometryPath;
+    std::string cacheName;
+    std::string defines;
+    std::vector<std::string> sourceFiles;
+    Build pending; // program 0 when no reload is under way
+
+    Build StartBuild();
+    bool FinishBuild(Build& build);
+    static void PrintSourceFiles(const ShaderPreprocessor::Result& code);
+    void BindUniformBlocks();
+    void CacheUniformLocations();
+};
+
+// Uniforms the program doesn't use (location -1) cost nothing and aren't counted
+inline void SetUniform(GLint location, float value) {
+    if (location < 0) return;
+    glUniform1f(location, value);
+    uniformUploadStats.uniforms++;
+}
+inline void SetUniform(GLint location, int value) {
+    if (location < 0) return;
+    glUniform1i(location, value);
+    uniformUploadStats.uniforms++;
+}
+inline void SetUniform(GLint location, bool value) {
+    if (location < 0) return;
+    glUniform1i(location, value);
+    uniformUploadStats.uniforms++;
+}
+inline void SetUniform(GLint location, const glm::vec2& value) {
+    if (location < 0) return;
+    glUniform2f(location, value.x, value.y);
+    uniformUploadStats.uniforms++;
+}
+inline void SetUniform(GLint location, const glm::vec3& value) {
+    if (location < 0) return;
+    glUniform3f(location, value.x, value.y, value.z);
+    uniformUploadStats.uniforms++;
+}
+inline void SetUniform(GLint location, const glm::mat4& value) {
+    if (location < 0) return;
+    glUniformMatrix4fv(location, 1, GL_FALSE, &value[0][0]);
+    uniformUploadStats.uniforms++;
+}
+
+// A uniform of one shader resolved up front, for values set every frame or many times over.
+// Like the Shader setters it writes to whatever program is in use.
+template <typename T>
+class UniformHandle {
+public:
+    UniformHandle() = default;
+    UniformHandle(const Shader& shader, UniformId name) : location(shader.Location(name)) {}
 
-    std::string PreprocessShader(const std::string& source, const std::string& includePath = "");
+    void Set(const T& value) const { SetUniform(location, value); }
+    GLint GetLocation() const { return location; }
 
+private:
+    GLint location = -1;
 };
@@ -0,0 +1,67 @@
+#include "shaderPermutations.h"
+#include "shader.h"
+#include "shaderReloader.h"
+#include <iostream>
+#include <stdexcept>
+
+ShaderPermutations::ShaderPermutations(Shader* generic, ShaderReloader& reloader) : generic(generic), reloader(reloader) {}
+
+ShaderPermutations::~ShaderPermutations() {
+    for (auto& [defines, permutation] : permutations) {
+        if (permutation.shader == nullptr) continue;
+        reloader.Unwatch(permutation.shader);
+        delete permutation.shader;
+    }
+}
+
+Shader* ShaderPermutations::Get(const std::string& defines) {
+    if (defines.empty()) return generic;
+    useCount++;
+    auto found = permutations.find(defines);
+    if (found == permutations.end()) {
+        Evict();
+        Permutation permutation;
+        permutation.started = Clock::now();
+        try {
+            permutation.shader = generic->CreatePermutation(defines);
+            // Watched from the start, an edit while it builds starts it over
+            reloader.Watch(permutation.shader);
+        }
+        catch (const std::runtime_error& e) {
+            std::cerr << "Not building a permutation of " << generic->GetName() << ": " << e.what() << std::endl;
+        }
+        found = permutations.emplace(defines, permutation).first;
+    }
+    found->second.lastUse = useCount;
+    return found->second.ready ? found->second.shader : generic;
+}
+
+void ShaderPermutations::Update() {
+    for (auto& [defines, permutation] : permutations) {
+        Shader* shader = permutation.shader;
+        if (shader == nullptr || permutation.ready) continue;
+        // The reloader may have finished it, or it failed and waits for an edit to the files
+        if (shader->IsReloading() && reloader.IsLinkDone(shader->GetPendingProgram())) shader->FinishReload();
+        if (shader->ID == 0) continue;
+
+        shader->CopyUniformsFrom(generic->ID);
+        permutation.ready = true;
+        double ms = std::chrono::duration<double, std::milli>(Clock::now() - permutation.started).count();
+        std::cout << "Built permutation " << shader->GetName() << " in " << ms << " ms" << std::endl;
+    }
+}
+
+// Makes room for one more
+void ShaderPermutations::Evict() {
+    while (permutations.size() >= maxPermutations) {
+        auto oldest = permutations.begin();
+        for (auto it = permutations.begin(); it != permutations.end(); ++it) {
+            if (it->second.lastUse < oldest->second.lastUse) oldest = it;
+        }
+        if (oldest->second.shader != nullptr) {
+            reloader.Unwatch(oldest->second.shader);
+            delete oldest->second.shader;
+        }
+        permutations.erase(oldest);
+    }
+}
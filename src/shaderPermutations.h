@@ -0,0 +1,42 @@
+#pragma once
+#include <chrono>
+#include <string>
+#include <unordered_map>
+
+class Shader;
+class ShaderReloader;
+
+// Programs of one shader built for fixed settings. The settings go in as #defines, so loops over them get
+// constant bounds and switched off paths drop out. The generic program, built without defines, draws until the
+// permutation for the current settings is built; that happens in the background, like a reload. Permutations
+// take the values set once on the generic program when they're done and reload along with it.
+class ShaderPermutations {
+public:
+    ShaderPermutations(Shader* generic, ShaderReloader& reloader);
+    ~ShaderPermutations();
+
+    // The program built for these defines, the generic one until it's done. Starts building it the first time.
+    Shader* Get(const std::string& defines);
+    // Picks up the builds the driver is done with, call once a frame
+    void Update();
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    struct Permutation {
+        Shader* shader = nullptr;   // null if the files couldn't be read
+        bool ready = false;
+        uint64_t lastUse = 0;
+        Clock::time_point started;
+    };
+
+    // Older permutations beyond this are dropped, least recently used first
+    static const size_t maxPermutations = 8;
+
+    Shader* generic;
+    ShaderReloader& reloader;
+    std::unordered_map<std::string, Permutation> permutations; // by defines
+    uint64_t useCount = 0;
+
+    void Evict();
+};
@@ -0,0 +1,165 @@
+#include "shaderPreprocessor.h"
+#include "embeddedShaders.h"
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+namespace {
+    bool IsSpace(char c) {
+        return c == ' ' || c == '\t' || c == '\r';
+    }
+
+    // File named by an #include "file" line, empty if the line is something else
+    std::string IncludeName(const std::string& text, size_t begin, size_t end) {
+        size_t i = begin;
+        while (i < end && IsSpace(text[i])) i++;
+        if (i == end || text[i] != '#') return "";
+        i++;
+        while (i < end && IsSpace(text[i])) i++;
+        static const std::string directive = "include";
+        if (text.compare(i, directive.size(), directive) != 0) return "";
+        i += directive.size();
+        while (i < end && IsSpace(text[i])) i++;
+        if (i == end || text[i] != '"') return "";
+        size_t nameEnd = text.find('"', i + 1);
+        if (nameEnd == std::string::npos || nameEnd >= end) return "";
+        return text.substr(i + 1, nameEnd - i - 1);
+    }
+}
+
+ShaderPreprocessor::ShaderPreprocessor(std::string includeDirectory) : includeDirectory(std::move(includeDirectory)) {}
+
+ShaderPreprocessor& ShaderPreprocessor::Shared() {
+    static ShaderPreprocessor preprocessor("shaders/");
+    return preprocessor;
+}
+
+void ShaderPreprocessor::SetReadFromDisk(bool readFromDisk) {
+    if (readFromDisk == this->readFromDisk) return;
+    this->readFromDisk = readFromDisk;
+    files.clear();
+    includedBy.clear();
+}
+
+bool ShaderPreprocessor::IsReadingFromDisk() const {
+    return readFromDisk;
+}
+
+ShaderPreprocessor::Result ShaderPreprocessor::Process(const std::string& path) {
+    Result result;
+    std::set<std::string> included;
+    Append(path, result, included);
+    return result;
+}
+
+void ShaderPreprocessor::Invalidate(const std::string& path) {
+    auto found = files.find(path);
+    if (found == files.end()) return;
+    for (const Segment& segment : found->second->segments) {
+        if (!segment.include.empty()) includedBy[segment.include].erase(path);
+    }
+    files.erase(found);
+}
+
+std::vector<std::string> ShaderPreprocessor::Dependents(const std::string& path) const {
+    std::vector<std::string> dependents;
+    std::set<std::string> seen = { path };
+    std::vector<std::string> pending = { path };
+    while (!pending.empty()) {
+        std::string file = pending.back();
+        pending.pop_back();
+        auto found = includedBy.find(file);
+        if (found == includedBy.end()) continue;
+        for (const std::string& parent : found->second) {
+            if (!seen.insert(parent).second) continue;
+            dependents.push_back(parent);
+            pending.push_back(parent);
+        }
+    }
+    return dependents;
+}
+
+const ShaderPreprocessor::ParsedFile& ShaderPreprocessor::Load(const std::string& path) {
+    auto found = files.find(path);
+    if (found != files.end()) return *found->second;
+
+    std::string text;
+    if (readFromDisk) {
+        std::ifstream stream(path);
+        if (!stream.is_open()) {
+            throw std::runtime_error("Could not open shader file: " + path);
+        }
+        std::stringstream buffer;
+        buffer << stream.rdbuf();
+        text = buffer.str();
+    }
+    else {
+        const EmbeddedShader* embedded = EmbeddedShaders::Find(path);
+        if (embedded == nullptr) {
+            throw std::runtime_error("No embedded shader file: " + path);
+        }
+        text = std::string(embedded->Text());
+    }
+
+    auto file = std::make_unique<ParsedFile>();
+    Segment current;
+    bool inBlockComment = false;
+    int line = 1;
+    size_t begin = 0;
+    while (begin < text.size()) {
+        size_t end = text.find('\n', begin);
+        size_t next = end == std::string::npos ? text.size() : end + 1;
+        if (end == std::string::npos) end = text.size();
+
+        std::string include = inBlockComment ? "" : IncludeName(text, begin, end);
+        if (include.empty()) {
+            current.text.append(text, begin, next - begin);
+        }
+        else {
+            current.include = includeDirectory + include;
+            current.lineAfter = line + 1;
+            includedBy[current.include].insert(path);
+            file->segments.push_back(std::move(current));
+            current = Segment();
+        }
+        // Directives inside /* */ don't count, track whether the line ends inside one
+        for (size_t i = begin; i + 1 < end; i++) {
+            if (!inBlockComment && text[i] == '/' && text[i + 1] == '/') break;
+            if (!inBlockComment && text[i] == '/' && text[i + 1] == '*') {
+                inBlockComment = true;
+                i++;
+            }
+            else if (inBlockComment && text[i] == '*' && text[i + 1] == '/') {
+                inBlockComment = false;
+                i++;
+            }
+        }
+        begin = next;
+        line++;
+    }
+    file->segments.push_back(std::move(current));
+    return *files.emplace(path, std::move(file)).first->second;
+}
+
+void ShaderPreprocessor::Append(const std::string& path, Result& result, std::set<std::string>& included) {
+    int index = static_cast<int>(result.files.size());
+    result.files.push_back(path);
+    // The root starts with #version, nothing may come before it
+    if (index > 0) result.source += "#line 1 " + std::to_string(index) + "\n";
+
+    const ParsedFile& file = Load(path);
+    for (const Segment& segment : file.segments) {
+        result.source += segment.text;
+        if (segment.include.empty()) continue;
+        if (included.insert(segment.include).second) {
+            Append(segment.include, result, included);
+            result.source += "#line " + std::to_string(segment.lineAfter) + " " + std::to_string(index) + "\n";
+        }
+        else {
+            // Already in this program, keep the line count
+            result.source += "\n";
+        }
+    }
+    // Files without a final newline would run into the #line that follows them
+    if (!result.source.empty() && result.source.back() != '\n') result.source += '\n';
+}
@@ -0,0 +1,55 @@
+#pragma once
+#include <memory>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Expands #include "file" directives of GLSL sources in one pass over each line. Files are read and split
+// once and kept in memory, and a file goes into a program's source only the first time it's included, so
+// headers can include what they need. #line directives number every file (the root is 0), compile errors
+// then point at the included file and line. Also keeps which files include which, for rebuilding the
+// programs a changed file went into. Files come from the copies compiled into the executable (see
+// embeddedShaders.h) unless it's told to read them from disk.
+class ShaderPreprocessor {
+public:
+    struct Result {
+        std::string source;
+        std::vector<std::string> files; // by #line source string number
+    };
+
+    explicit ShaderPreprocessor(std::string includeDirectory);
+
+    // Preprocessor for the shaders directory, created on first use
+    static ShaderPreprocessor& Shared();
+
+    // Reading from disk picks up edits, embedded files are what the executable was built with. Drops what was read.
+    void SetReadFromDisk(bool readFromDisk);
+    bool IsReadingFromDisk() const;
+
+    // Throws std::runtime_error if a file can't be read
+    Result Process(const std::string& path);
+    // Drops what was read from a file, the next Process reads it again
+    void Invalidate(const std::string& path);
+    // Files that include this one, directly or through others
+    std::vector<std::string> Dependents(const std::string& path) const;
+
+private:
+    // A file cut at its includes: each segment is the text up to an include directive and the file it names
+    struct Segment {
+        std::string text;
+        std::string include;   // empty for the text after the last include
+        int lineAfter = 0;     // number of the line after the directive
+    };
+    struct ParsedFile {
+        std::vector<Segment> segments;
+    };
+
+    const ParsedFile& Load(const std::string& path);
+    void Append(const std::string& path, Result& result, std::set<std::string>& included);
+
+    std::string includeDirectory;
+    bool readFromDisk = false;
+    std::unordered_map<std::string, std::unique_ptr<ParsedFile>> files;
+    std::unordered_map<std::string, std::set<std::string>> includedBy; // file -> files that include it directly
+};
@@ -0,0 +1,182 @@
+#include "shaderReloader.h"
+#include "shader.h"
+#include "shaderPreprocessor.h"
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <set>
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+namespace {
+    // Not in the GL 3.3 headers glad was generated for
+    const GLenum completionStatus = 0x91B1;
+    const GLuint anyThreadCount = 0xFFFFFFFF;
+
+    typedef void (APIENTRYP MaxShaderCompilerThreadsProc)(GLuint count);
+
+    const double pollSeconds = 0.25;
+
+    bool HasExtension(const char* name) {
+        GLint count = 0;
+        glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+        for (GLint i = 0; i < count; i++) {
+            const GLubyte* extension = glGetStringi(GL_EXTENSIONS, i);
+            if (extension && std::strcmp(reinterpret_cast<const char*>(extension), name) == 0) return true;
+        }
+        return false;
+    }
+
+    // Editors write swap and backup files next to the ones they save
+    bool IsShaderFile(const std::string& name) {
+        std::string extension = std::filesystem::path(name).extension().string();
+        return extension == ".glsl" || extension == ".vert" || extension == ".frag" || extension == ".geom";
+    }
+}
+
+void ShaderReloader::Init(GLADloadproc load, bool watchFiles, const std::string& directory) {
+    this->directory = directory;
+    this->watchFiles = watchFiles;
+
+    MaxShaderCompilerThreadsProc maxThreads = nullptr;
+    if (HasExtension("GL_KHR_parallel_shader_compile")) {
+        maxThreads = reinterpret_cast<MaxShaderCompilerThreadsProc>(load("glMaxShaderCompilerThreadsKHR"));
+    }
+    else if (HasExtension("GL_ARB_parallel_shader_compile")) {
+        maxThreads = reinterpret_cast<MaxShaderCompilerThreadsProc>(load("glMaxShaderCompilerThreadsARB"));
+    }
+    parallelCompile = maxThreads != nullptr;
+    if (parallelCompile) maxThreads(anyThreadCount);
+
+    if (!watchFiles) {
+        std::cout << "Shader reload: off, shaders are embedded, "
+            << (parallelCompile ? "parallel compile" : "compiling on the render thread") << std::endl;
+        return;
+    }
+#ifdef __linux__
+    inotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    // Saving either writes the file in place or renames a new one over it
+    if (inotifyFd >= 0 && inotify_add_watch(inotifyFd, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO) < 0) {
+        close(inotifyFd);
+        inotifyFd = -1;
+    }
+#endif
+    std::cout << "Shader reload: " << (inotifyFd >= 0 ? "inotify" : "polling") << ", "
+        << (parallelCompile ? "parallel compile" : "compiling on the render thread") << std::endl;
+    lastPoll = Clock::now();
+}
+
+void ShaderReloader::Destroy() {
+    for (Shader* shader : shaders) shader->CancelReload();
+    shaders.clear();
+    reloadStarts.clear();
+#ifdef __linux__
+    if (inotifyFd >= 0) close(inotifyFd);
+#endif
+    inotifyFd = -1;
+}
+
+void ShaderReloader::Watch(Shader* shader) {
+    shaders.push_back(shader);
+    if (watchFiles && inotifyFd < 0) PollModifiedTimes();
+}
+
+void ShaderReloader::Unwatch(Shader* shader) {
+    shaders.erase(std::remove(shaders.begin(), shaders.end(), shader), shaders.end());
+    reloadStarts.erase(shader);
+}
+
+bool ShaderReloader::IsParallelCompileSupported() const {
+    return parallelCompile;
+}
+
+std::vector<Shader*> ShaderReloader::Update() {
+    std::vector<std::string> changed = ChangedFiles();
+    if (!changed.empty()) {
+        ShaderPreprocessor& preprocessor = ShaderPreprocessor::Shared();
+        std::set<std::string> affected;
+        for (const std::string& file : changed) {
+            preprocessor.Invalidate(file);
+            affected.insert(file);
+            for (const std::string& dependent : preprocessor.Dependents(file)) affected.insert(dependent);
+        }
+        for (Shader* shader : shaders) {
+            const std::vector<std::string>& files = shader->GetSourceFiles();
+            bool reached = std::any_of(files.begin(), files.end(), [&](const std::string& file) { return affected.count(file) > 0; });
+            if (!reached) continue;
+            if (shader->StartReload()) reloadStarts[shader] = Clock::now();
+            else reloadStarts.erase(shader);
+        }
+    }
+
+    std::vector<Shader*> replaced;
+    for (auto reload = reloadStarts.begin(); reload != reloadStarts.end();) {
+        Shader* shader = reload->first;
+        if (!IsLinkDone(shader->GetPendingProgram())) {
+            ++reload;
+            continue;
+        }
+        if (shader->FinishReload()) {
+            replaced.push_back(shader);
+            double ms = std::chrono::duration<double, std::milli>(Clock::now() - reload->second).count();
+            std::cout << "Reloaded " << shader->GetName() << " in " << ms << " ms" << std::endl;
+        }
+        reload = reloadStarts.erase(reload);
+    }
+    return replaced;
+}
+
+bool ShaderReloader::IsLinkDone(GLuint program) const {
+    if (!parallelCompile) return true;
+    GLint done = GL_FALSE;
+    glGetProgramiv(program, completionStatus, &done);
+    return done == GL_TRUE;
+}
+
+std::vector<std::string> ShaderReloader::ChangedFiles() {
+    std::vector<std::string> changed;
+    if (!watchFiles) return changed;
+#ifdef __linux__
+    if (inotifyFd >= 0) {
+        alignas(inotify_event) char buffer[4096];
+        ssize_t length;
+        while ((length = read(inotifyFd, buffer, sizeof(buffer))) > 0) {
+            for (ssize_t offset = 0; offset < length;) {
+                const inotify_event* event = reinterpret_cast<const inotify_event*>(buffer + offset);
+                if (event->len > 0 && IsShaderFile(event->name)) {
+                    std::string file = directory + event->name;
+                    if (std::find(changed.begin(), changed.end(), file) == changed.end()) changed.push_back(file);
+                }
+                offset += sizeof(inotify_event) + event->len;
+            }
+        }
+        return changed;
+    }
+#endif
+    if (std::chrono::duration<double>(Clock::now() - lastPoll).count() < pollSeconds) return changed;
+    lastPoll = Clock::now();
+    return PollModifiedTimes();
+}
+
+// Files seen for the first time only get their time noted
+std::vector<std::string> ShaderReloader::PollModifiedTimes() {
+    std::vector<std::string> changed;
+    std::set<std::string> files;
+    for (Shader* shader : shaders) files.insert(shader->GetSourceFiles().begin(), shader->GetSourceFiles().end());
+    for (const std::string& file : files) {
+        std::error_code error;
+        std::filesystem::file_time_type time = std::filesystem::last_write_time(file, error);
+        if (error) continue; // mid-save
+        auto known = modifiedTimes.find(file);
+        if (known == modifiedTimes.end()) {
+            modifiedTimes[file] = time;
+        }
+        else if (known->second != time) {
+            known->second = time;
+            changed.push_back(file);
+        }
+    }
+    return changed;
+}
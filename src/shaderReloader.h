@@ -0,0 +1,48 @@
+#pragma once
+#include <chrono>
+#include <filesystem>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <glad/glad.h>
+
+class Shader;
+
+// Rebuilds programs while the app runs when a file they were built from changes. Changes in the shaders
+// directory come from inotify on Linux, elsewhere the files are polled for their modification times.
+// The programs reached by a change are found through the includes the preprocessor recorded. With
+// KHR_parallel_shader_compile the driver compiles on its own threads and a program is only swapped in once
+// it's done, without it the compile finishes on the frame that picked up the change. Files are only watched
+// when the preprocessor reads them from disk, embedded ones can't change.
+class ShaderReloader {
+public:
+    // Looks up the parallel compile entry points and starts watching if asked to, call once glad is loaded
+    void Init(GLADloadproc load, bool watchFiles, const std::string& directory = "shaders/");
+    void Destroy();
+    void Watch(Shader* shader);
+    void Unwatch(Shader* shader);
+
+    // Call once a frame. Starts reloads for changed files and returns the shaders whose program was replaced.
+    std::vector<Shader*> Update();
+
+    bool IsParallelCompileSupported() const;
+    // Whether the driver is done compiling and linking, without waiting. Always true without parallel compile.
+    bool IsLinkDone(GLuint program) const;
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    std::string directory;
+    std::vector<Shader*> shaders;
+    std::unordered_map<Shader*, Clock::time_point> reloadStarts;
+    bool parallelCompile = false;
+    bool watchFiles = false;
+
+    int inotifyFd = -1;
+    // Polling when there's no inotify
+    std::unordered_map<std::string, std::filesystem::file_time_type> modifiedTimes;
+    Clock::time_point lastPoll;
+
+    std::vector<std::string> ChangedFiles();
+    std::vector<std::string> PollModifiedTimes();
+};
@@ -2,6 +2,7 @@
 #include "sphere.h"
 #include <glad/glad.h>
 #include "globals.h"
+#include "glState.h"
 
 const std::array<glm::vec3, 6> Sphere::m_Directions = {
     glm::vec3(0, 1, 0), glm::vec3(0, -1, 0),
@@ -28,7 +29,7 @@ bool Sphere::Create(float radius, int resolution) {
     glGenBuffers(1, &m_nVBO);
     glGenBuffers(1, &m_nEBO);
 
-    glBindVertexArray(m_nVAO);
+    GLState::BindVertexArray(m_nVAO);
 
     // Position data
     glBindBuffer(GL_ARRAY_BUFFER, m_nVBO);
@@ -42,7 +43,8 @@ bool Sphere::Create(float radius, int resolution) {
     glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(glm::vec3), (void*)0);
     glEnableVertexAttribArray(0);
 
-    glBindVertexArray(0);
+    // Element buffer bindings would go into the vertex array while it's bound
+    GLState::BindVertexArray(0);
 
     m_nIndexCount = m_vIndices.size();
     return true;
@@ -50,7 +52,7 @@ bool Sphere::Create(float radius, int resolution) {
 
 void Sphere::Destroy() {
     if (m_nVAO) {
-        glDeleteVertexArrays(1, &m_nVAO);
+        GLState::DeleteVertexArray(m_nVAO);
         glDeleteBuffers(1, &m_nVBO);
         glDeleteBuffers(1, &m_nEBO);
         m_nVAO = m_nVBO = m_nEBO = 0;
@@ -59,7 +61,7 @@ void Sphere::Destroy() {
 
 void Sphere::Draw() const {
     if (m_nVAO) {
-        glBindVertexArray(m_nVAO);
+        GLState::BindVertexArray(m_nVAO);
         glDrawElements(GL_TRIANGLES, (GLsizei)m_nIndexCount, GL_UNSIGNED_INT, 0);
     }
 }
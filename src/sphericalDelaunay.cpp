@@ -0,0 +1,301 @@
+#include "sphericalDelaunay.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <numeric>
+#include <random>
+#include "cubeMap.h"
+
+namespace {
+    uint64_t MortonCode(uint32_t x, uint32_t y) {
+        auto spread = [](uint64_t v) {
+            v = (v | (v << 16)) & 0x0000FFFF0000FFFFull;
+            v = (v | (v << 8)) & 0x00FF00FF00FF00FFull;
+            v = (v | (v << 4)) & 0x0F0F0F0F0F0F0F0Full;
+            v = (v | (v << 2)) & 0x3333333333333333ull;
+            return (v | (v << 1)) & 0x5555555555555555ull;
+        };
+        return spread(x) | (spread(y) << 1);
+    }
+
+    struct HullFace {
+        int v[3];          // counter clockwise seen from outside
+        int adjacent[3];   // face across the edge v[k] -> v[(k + 1) % 3]
+        glm::dvec3 normal; // not normalized
+        bool alive;
+        std::vector<int> conflicts; // points not yet inserted that can see this face
+    };
+}
+
+SphericalDelaunay::SphericalDelaunay(const std::vector<glm::vec3>& sites) : sites(sites) {
+    BuildHull();
+    BuildNeighbours();
+    BuildLocator();
+}
+
+void SphericalDelaunay::BuildHull() {
+    const int count = static_cast<int>(sites.size());
+    if (count < 4) return;
+
+    // The hull works on its own copy of the points, stored along a space filling curve.
+    // Conflict lists hold nearby points, so this keeps their lookups in cache.
+    std::vector<uint64_t> keys(count);
+    for (int i = 0; i < count; i++) {
+        glm::vec2 uv;
+        int face = CubeMap::FaceCoords(sites[i], uv);
+        keys[i] = (static_cast<uint64_t>(face) << 32) | MortonCode(CubeMap::CoordToTexel(uv.x, 65536), CubeMap::CoordToTexel(uv.y, 65536));
+    }
+    std::vector<int> siteOf(count);
+    std::iota(siteOf.begin(), siteOf.end(), 0);
+    std::sort(siteOf.begin(), siteOf.end(), [&](int i, int j) { return keys[i] < keys[j]; });
+
+    // Float sites are only on the sphere to about 1e-7, more than the sphere bulges between close sites,
+    // which would leave some of them inside the hull. Projected again in double they are all on it.
+    std::vector<glm::dvec3> points(count);
+    for (int i = 0; i < count; i++) {
+        glm::dvec3 p = glm::dvec3(sites[siteOf[i]]);
+        points[i] = p * (1.0 / std::sqrt(glm::dot(p, p)));
+    }
+
+    // Random insertion order is what makes the expected cost O(N log N), whatever order the sites came in
+    std::vector<int> order(count);
+    std::iota(order.begin(), order.end(), 0);
+    std::shuffle(order.begin(), order.end(), std::mt19937(static_cast<uint32_t>(count)));
+
+    // Starting tetrahedron: the first point, then the next ones that aren't collinear / coplanar with it
+    auto lengthSquared = [](const glm::dvec3& v) { return glm::dot(v, v); };
+    int second = 1, third = -1, fourth = -1;
+    glm::dvec3 a = points[order[0]];
+    for (int i = 2; i < count && third < 0; i++) {
+        if (lengthSquared(glm::cross(points[order[1]] - a, points[order[i]] - a)) > 1e-12) third = i;
+    }
+    if (third < 0) return;
+    glm::dvec3 planeNormal = glm::cross(points[order[second]] - a, points[order[third]] - a);
+    for (int i = 2; i < count && fourth < 0; i++) {
+        if (i != third && std::abs(glm::dot(planeNormal, points[order[i]] - a)) > 1e-9) fourth = i;
+    }
+    if (fourth < 0) return;
+    std::swap(order[2], order[third]);
+    std::swap(order[3], order[fourth == 2 ? third : fourth]);
+
+    std::vector<HullFace> faces;
+    // The faces a point can see are connected, so one of them is enough to find the rest
+    std::vector<int> pointConflict(count, -1);
+    std::vector<char> inserted(count, 0);
+
+    auto makeFace = [&](int v0, int v1, int v2) {
+        HullFace face;
+        face.v[0] = v0; face.v[1] = v1; face.v[2] = v2;
+        face.adjacent[0] = face.adjacent[1] = face.adjacent[2] = -1;
+        face.normal = glm::cross(points[v1] - points[v0], points[v2] - points[v0]);
+        face.alive = true;
+        faces.push_back(std::move(face));
+        return static_cast<int>(faces.size()) - 1;
+    };
+    auto visible = [&](int f, int p) {
+        const HullFace& face = faces[f];
+        return glm::dot(face.normal, points[p] - points[face.v[0]]) > 0.0;
+    };
+
+    const int t[4] = { order[0], order[1], order[2], order[3] };
+    glm::dvec3 centroid = (points[t[0]] + points[t[1]] + points[t[2]] + points[t[3]]) * 0.25;
+    for (int i = 0; i < 4; i++) inserted[t[i]] = 1;
+    const int tetrahedron[4][3] = { { 0, 1, 2 }, { 0, 2, 3 }, { 0, 3, 1 }, { 1, 3, 2 } };
+    for (const auto& tri : tetrahedron) {
+        int f = makeFace(t[tri[0]], t[tri[1]], t[tri[2]]);
+        if (glm::dot(faces[f].normal, centroid - points[faces[f].v[0]]) > 0.0) {
+            faces.pop_back();
+            makeFace(t[tri[0]], t[tri[2]], t[tri[1]]);
+        }
+    }
+    for (int f = 0; f < 4; f++) {
+        for (int k = 0; k < 3; k++) {
+            int from = faces[f].v[k], to = faces[f].v[(k + 1) % 3];
+            for (int g = 0; g < 4; g++) {
+                for (int j = 0; j < 3; j++) {
+                    if (faces[g].v[j] == to && faces[g].v[(j + 1) % 3] == from) faces[f].adjacent[k] = g;
+                }
+            }
+        }
+    }
+    for (int i = 4; i < count; i++) {
+        for (int f = 0; f < 4; f++) {
+            if (visible(f, order[i])) {
+                faces[f].conflicts.push_back(order[i]);
+                pointConflict[order[i]] = f;
+            }
+        }
+    }
+
+    std::vector<int> visibleMark, candidateMark(count, -1);
+    std::vector<int> startsAt(count, -1), endsAt(count, -1);
+    std::vector<int> visibleFaces;
+    struct HorizonEdge { int from, to, inside, outside; };
+    std::vector<HorizonEdge> horizon;
+    std::vector<int> newFaces;
+
+    for (int i = 4; i < count; i++) {
+        const int p = order[i];
+        inserted[p] = 1;
+        if (pointConflict[p] < 0) continue; // duplicate of another site, it never owns a cell
+
+        // Flood the faces p can see from the one it knows about
+        visibleMark.resize(faces.size(), -1);
+        visibleFaces.assign(1, pointConflict[p]);
+        visibleMark[pointConflict[p]] = p;
+        for (size_t v = 0; v < visibleFaces.size(); v++) {
+            for (int g : faces[visibleFaces[v]].adjacent) {
+                if (visibleMark[g] != p && visible(g, p)) {
+                    visibleMark[g] = p;
+                    visibleFaces.push_back(g);
+                }
+            }
+        }
+
+        // Edges between the faces p sees and the ones it doesn't
+        horizon.clear();
+        for (int f : visibleFaces) {
+            for (int k = 0; k < 3; k++) {
+                int g = faces[f].adjacent[k];
+                if (visibleMark[g] != p) horizon.push_back({ faces[f].v[k], faces[f].v[(k + 1) % 3], f, g });
+            }
+        }
+
+        // Cone of new faces from the horizon to p
+        newFaces.clear();
+        for (const HorizonEdge& edge : horizon) {
+            int h = makeFace(edge.from, edge.to, p);
+            faces[h].adjacent[0] = edge.outside;
+            for (int k = 0; k < 3; k++) {
+                if (faces[edge.outside].adjacent[k] == edge.inside) faces[edge.outside].adjacent[k] = h;
+            }
+            startsAt[edge.from] = h;
+            endsAt[edge.to] = h;
+            newFaces.push_back(h);
+
+            // Anything that can see the new face could see one of the two faces on its horizon edge
+            auto test = [&](int q) {
+                if (candidateMark[q] == h) return;
+                candidateMark[q] = h;
+                if (visible(h, q)) {
+                    faces[h].conflicts.push_back(q);
+                    pointConflict[q] = h;
+                }
+            };
+            for (int q : faces[edge.inside].conflicts) {
+                if (!inserted[q]) test(q);
+            }
+            // The surviving face keeps its list, minus points that have been inserted since
+            std::vector<int>& outside = faces[edge.outside].conflicts;
+            outside.erase(std::remove_if(outside.begin(), outside.end(), [&](int q) { return inserted[q] != 0; }), outside.end());
+            for (int q : outside) test(q);
+        }
+        for (int h : newFaces) {
+            faces[h].adjacent[1] = startsAt[faces[h].v[1]];
+            faces[h].adjacent[2] = endsAt[faces[h].v[0]];
+        }
+
+        // Points that could only see deleted faces and none of the new ones are inside the hull now
+        // (never happens on the sphere, but keeps them from pointing at a dead face)
+        for (int f : visibleFaces) faces[f].alive = false;
+        for (int f : visibleFaces) {
+            for (int q : faces[f].conflicts) {
+                if (!inserted[q] && !faces[pointConflict[q]].alive) pointConflict[q] = -1;
+            }
+            std::vector<int>().swap(faces[f].conflicts);
+        }
+    }
+
+    for (const HullFace& face : faces) {
+        if (face.alive) triangles.push_back({ siteOf[face.v[0]], siteOf[face.v[1]], siteOf[face.v[2]] });
+    }
+}
+
+void SphericalDelaunay::BuildNeighbours() {
+    const int count = static_cast<int>(sites.size());
+    if (triangles.empty()) {
+        // Up to 3 sites (or all on one circle) there is no hull, but every cell borders every other one
+        neighbourOffsets.resize(count + 1);
+        neighbours.clear();
+        for (int i = 0; i < count; i++) {
+            neighbourOffsets[i] = static_cast<int>(neighbours.size());
+            for (int j = 0; j < count; j++) {
+                if (j != i) neighbours.push_back(j);
+            }
+        }
+        neighbourOffsets[count] = static_cast<int>(neighbours.size());
+        return;
+    }
+
+    // Every edge shows up once in each direction, so each triangle adds one neighbour per corner
+    neighbourOffsets.assign(count + 1, 0);
+    for (const auto& tri : triangles) {
+        for (int k = 0; k < 3; k++) neighbourOffsets[tri[k] + 1]++;
+    }
+    for (int i = 0; i < count; i++) {
+        neighbourOffsets[i + 1] += neighbourOffsets[i];
+    }
+    neighbours.resize(neighbourOffsets[count]);
+    std::vector<int> cursor(neighbourOffsets.begin(), neighbourOffsets.end() - 1);
+    for (const auto& tri : triangles) {
+        for (int k = 0; k < 3; k++) neighbours[cursor[tri[k]]++] = tri[(k + 1) % 3];
+    }
+}
+
+void SphericalDelaunay::BuildLocator() {
+    if (sites.empty()) return;
+
+    // About one site per cell, so the walk from the cell's site is a step or two
+    gridResolution = std::max(1, static_cast<int>(std::ceil(std::sqrt(sites.size() / 6.0))));
+    gridSites.resize(CubeMap::faceCount * gridResolution * gridResolution);
+    int site = 0;
+    for (int face = 0; face < CubeMap::faceCount; face++) {
+        for (int y = 0; y < gridResolution; y++) {
+            for (int x = 0; x < gridResolution; x++) {
+                glm::vec3 center = glm::normalize(CubeMap::Direction(face, CubeMap::TexelCenter(x, y, gridResolution)));
+                site = LocateFrom(center, site);
+                gridSites[(face * gridResolution + y) * gridResolution + x] = site;
+            }
+        }
+    }
+}
+
+int SphericalDelaunay::Locate(const glm::vec3& point) const {
+    if (gridSites.empty()) return -1;
+    glm::vec2 uv;
+    int face = CubeMap::FaceCoords(point, uv);
+    int x = CubeMap::CoordToTexel(uv.x, gridResolution);
+    int y = CubeMap::CoordToTexel(uv.y, gridResolution);
+    return LocateFrom(point, gridSites[(face * gridResolution + y) * gridResolution + x]);
+}
+
+int SphericalDelaunay::LocateFrom(const glm::vec3& point, int site) const {
+    // If a site isn't the closest, one of its Delaunay neighbours is closer, so greedy steps end at the right one.
+    // On the unit sphere closer means a larger dot product.
+    float best = glm::dot(point, sites[site]);
+    while (true) {
+        int next = site;
+        for (int i = neighbourOffsets[site]; i < neighbourOffsets[site + 1]; i++) {
+            float d = glm::dot(point, sites[neighbours[i]]);
+            if (d > best) {
+                best = d;
+                next = neighbours[i];
+            }
+        }
+        if (next == site) return site;
+        site = next;
+    }
+}
+
+int SphericalDelaunay::LocateBruteForce(const glm::vec3& point) const {
+    int closest = -1;
+    float best = -2.0f;
+    for (int i = 0; i < static_cast<int>(sites.size()); i++) {
+        float d = glm::dot(point, sites[i]);
+        if (d > best) {
+            best = d;
+            closest = i;
+        }
+    }
+    return closest;
+}
@@ -0,0 +1,41 @@
+#pragma once
+#include <array>
+#include <vector>
+#include <glm/glm.hpp>
+
+// Delaunay triangulation of points on the unit sphere. It is the same thing as their convex hull,
+// which is built incrementally in random order with a conflict graph (expected O(N log N)).
+// The Voronoi cell of a site is the set of points closer to it than to any other site.
+class SphericalDelaunay {
+public:
+    explicit SphericalDelaunay(const std::vector<glm::vec3>& sites);
+
+    const std::vector<glm::vec3>& GetSites() const { return sites; }
+    // Counter clockwise seen from outside
+    const std::vector<std::array<int, 3>>& GetTriangles() const { return triangles; }
+    // Sites sharing a Delaunay edge (a Voronoi cell border) with site i are
+    // neighbours[neighbourOffsets[i]] .. neighbours[neighbourOffsets[i + 1] - 1]
+    const std::vector<int>& GetNeighbourOffsets() const { return neighbourOffsets; }
+    const std::vector<int>& GetNeighbours() const { return neighbours; }
+
+    // Site whose Voronoi cell contains a point on the unit sphere. Starts at the site stored for
+    // the point's cell in a cube face grid and walks to neighbours closer to the point from there.
+    int Locate(const glm::vec3& point) const;
+    // Same, walking from the given site
+    int LocateFrom(const glm::vec3& point, int site) const;
+    // Reference version testing every site, for validating and benchmarking Locate
+    int LocateBruteForce(const glm::vec3& point) const;
+
+private:
+    void BuildHull();
+    void BuildNeighbours();
+    void BuildLocator();
+
+    std::vector<glm::vec3> sites;
+    std::vector<std::array<int, 3>> triangles;
+    std::vector<int> neighbourOffsets;
+    std::vector<int> neighbours;
+
+    int gridResolution = 0;
+    std::vector<int> gridSites; // closest site to each grid cell center, faces in GL order
+};
@@ -0,0 +1,48 @@
+#include "temporalHistory.h"
+
+void TemporalHistory::Resize(int width, int height) {
+    if (targets[0].GetWidth() == width && targets[0].GetHeight() == height &&
+        targets[1].GetWidth() == width && targets[1].GetHeight() == height) return;
+    targets[0].Resize(width, height);
+    targets[1].Resize(width, height);
+    valid = false;
+}
+
+void TemporalHistory::Destroy() {
+    targets[0].Destroy();
+    targets[1].Destroy();
+    valid = false;
+}
+
+void TemporalHistory::TrackInputs(const std::vector<float>& inputs) {
+    if (inputs == trackedInputs) return;
+    trackedInputs = inputs;
+    valid = false;
+}
+
+void TemporalHistory::BeginFrame(const glm::mat4& newViewProjection, const glm::mat4& newModel, const glm::vec3& newCameraPos) {
+    viewProjection = newViewProjection;
+    model = newModel;
+    cameraPos = newCameraPos;
+}
+
+void TemporalHistory::Bind(Shader* shader, int textureUnit) const {
+    shader->setMat4("previousViewProjection", previousViewProjection);
+    // Back to where a point on the planet was last frame
+    shader->setMat4("previousModelFromModel", previousModel * glm::inverse(model));
+    shader->setVec3("previousCameraPos", previousCameraPos);
+    shader->setInt("temporalFrame", static_cast<int>(frame % 4));
+    shader->setBool("historyValid", valid);
+    glActiveTexture(GL_TEXTURE0 + textureUnit);
+    glBindTexture(GL_TEXTURE_2D, targets[1 - current].GetColorTexture());
+    glActiveTexture(GL_TEXTURE0);
+}
+
+void TemporalHistory::EndFrame() {
+    previousViewProjection = viewProjection;
+    previousModel = model;
+    previousCameraPos = cameraPos;
+    current = 1 - current;
+    valid = true;
+    frame++;
+}
@@ -0,0 +1,40 @@
+#pragma once
+#include <vector>
+#include <glm/glm.hpp>
+#include "renderTarget.h"
+#include "shader.h"
+
+// Last frame's result of a full-screen pass and what it takes to find where a pixel was in it.
+// Passes using it redraw a quarter of their pixels each frame and take the rest from the history
+// wherever it still fits (see temporal.glsl), their color alpha has to hold the distance to the camera.
+class TemporalHistory {
+public:
+    // The history is dropped when the size changes
+    void Resize(int width, int height);
+    void Destroy();
+    // Starts a frame seen through these matrices, model is the planet's
+    void BeginFrame(const glm::mat4& viewProjection, const glm::mat4& model, const glm::vec3& cameraPos);
+    // Where the pass draws this frame
+    RenderTarget& Current() { return targets[current]; }
+    // Sets the uniforms of temporal.glsl and binds last frame's result to the texture unit of its history sampler
+    void Bind(Shader* shader, int textureUnit) const;
+    // This frame's result becomes the next one's history
+    void EndFrame();
+    // For when what the pass draws changed everywhere at once
+    void Invalidate() { valid = false; }
+    // Everything but the camera the pass draws with, the history is dropped when any of it changes
+    void TrackInputs(const std::vector<float>& inputs);
+
+private:
+    RenderTarget targets[2];
+    int current = 0;
+    bool valid = false; // the other target holds a finished frame
+    unsigned frame = 0;
+    std::vector<float> trackedInputs;
+    glm::mat4 viewProjection = glm::mat4(1.0f);
+    glm::mat4 previousViewProjection = glm::mat4(1.0f);
+    glm::mat4 model = glm::mat4(1.0f);
+    glm::mat4 previousModel = glm::mat4(1.0f);
+    glm::vec3 cameraPos = glm::vec3(0.0f);
+    glm::vec3 previousCameraPos = glm::vec3(0.0f);
+};
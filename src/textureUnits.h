@@ -0,0 +1,26 @@
+#pragma once
+
+// Texture units used by the planet and atmosphere shaders.
+// Each sampler gets a fixed unit so the textures can stay bound across frames.
+// Unit 0 belongs to none of them, it's where textures are bound to be created or filled.
+enum TextureUnit {
+    TEXTURE_UNIT_CRATER_CELLS = 1,
+    TEXTURE_UNIT_CRATER_CELL_OFFSETS = 2,
+    TEXTURE_UNIT_HEIGHTMAP = 3,
+    TEXTURE_UNIT_PLATE_CELLS = 4,
+    TEXTURE_UNIT_PLATE_DATA = 5,
+    TEXTURE_UNIT_PLATE_NEIGHBOURS = 6,
+    TEXTURE_UNIT_TRANSMITTANCE_LUT = 7,
+    TEXTURE_UNIT_MULTI_SCATTERING_LUT = 8,
+    TEXTURE_UNIT_SCENE_COLOR = 9,
+    TEXTURE_UNIT_SCENE_DEPTH = 10,
+    TEXTURE_UNIT_ATMOSPHERE = 11,
+    TEXTURE_UNIT_SKY_VIEW_LUT = 12,
+    TEXTURE_UNIT_AERIAL_PERSPECTIVE = 13,
+    TEXTURE_UNIT_ATMOSPHERE_HISTORY = 14,
+    TEXTURE_UNIT_HUMIDITY_MAP = 15,
+    TEXTURE_UNIT_CLOUD_HISTORY = 16,
+    TEXTURE_UNIT_CLOUD_NOISE = 17,
+    TEXTURE_UNIT_CLOUDS = 18,
+    TEXTURE_UNIT_WORLEY_TABLE = 19,
+};
@@ -0,0 +1,83 @@
+#include "threadPool.h"
+#include <algorithm>
+#include <atomic>
+
+ThreadPool::ThreadPool(unsigned threadCount) {
+    for (unsigned i = 0; i < std::max(threadCount, 1u); i++) {
+        threads.emplace_back(&ThreadPool::WorkerLoop, this);
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    condition.notify_all();
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+}
+
+ThreadPool& ThreadPool::Shared() {
+    static ThreadPool pool(std::max(std::thread::hardware_concurrency(), 1u));
+    return pool;
+}
+
+void ThreadPool::Enqueue(std::function<void()> task) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        tasks.push(std::move(task));
+    }
+    condition.notify_one();
+}
+
+void ThreadPool::WorkerLoop() {
+    while (true) {
+        std::function<void()> task;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            condition.wait(lock, [this]() { return stopping || !tasks.empty(); });
+            if (stopping && tasks.empty()) return;
+            task = std::move(tasks.front());
+            tasks.pop();
+        }
+        task();
+    }
+}
+
+void ThreadPool::ParallelFor(int count, const std::function<void(int)>& body) {
+    if (count <= 0) return;
+
+    // Items are handed out through a shared counter. The caller works on them too and only waits
+    // for items that are already being processed, so helpers stuck in the queue behind other work
+    // (or a call from inside a pool task) can't deadlock it.
+    struct State {
+        std::atomic<int> next{ 0 };
+        std::atomic<int> done{ 0 };
+        std::mutex mutex;
+        std::condition_variable finished;
+    };
+    auto state = std::make_shared<State>();
+    const std::function<void(int)>* work = &body;
+
+    auto run = [state, work, count]() {
+        int i;
+        while ((i = state->next++) < count) {
+            (*work)(i);
+            if (++state->done == count) {
+                std::lock_guard<std::mutex> lock(state->mutex);
+                state->finished.notify_all();
+            }
+        }
+    };
+
+    int helpers = std::min(static_cast<int>(threads.size()), count - 1);
+    for (int h = 0; h < helpers; h++) {
+        Enqueue(run);
+    }
+    run();
+
+    std::unique_lock<std::mutex> lock(state->mutex);
+    state->finished.wait(lock, [&]() { return state->done == count; });
+}
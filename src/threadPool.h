@@ -0,0 +1,44 @@
+#pragma once
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+// Fixed set of worker threads shared by the CPU baking code (heightmaps, erosion, LUTs).
+class ThreadPool {
+public:
+    explicit ThreadPool(unsigned threadCount);
+    ~ThreadPool();
+
+    // Pool sized to the machine, created on first use
+    static ThreadPool& Shared();
+
+    unsigned GetThreadCount() const { return static_cast<unsigned>(threads.size()); }
+
+    // Runs a task on a worker thread
+    template <typename F>
+    auto Submit(F&& task) -> std::future<decltype(task())> {
+        auto packaged = std::make_shared<std::packaged_task<decltype(task())()>>(std::forward<F>(task));
+        std::future<decltype(task())> result = packaged->get_future();
+        Enqueue([packaged]() { (*packaged)(); });
+        return result;
+    }
+
+    // Calls body(i) for every i in [0, count) spread over the workers and the calling thread,
+    // and returns once all of them are done. Safe to call from inside a pool task.
+    void ParallelFor(int count, const std::function<void(int)>& body);
+
+private:
+    void Enqueue(std::function<void()> task);
+    void WorkerLoop();
+
+    std::vector<std::thread> threads;
+    std::queue<std::function<void()>> tasks;
+    std::mutex mutex;
+    std::condition_variable condition;
+    bool stopping = false;
+};
@@ -0,0 +1,46 @@
+#include "uniformBuffers.h"
+#include "shader.h"
+#include <cstring>
+#include <iostream>
+
+int UniformBlockBinding(std::string_view blockName) {
+    if (blockName == "FrameData") return UNIFORM_BINDING_FRAME;
+    if (blockName == "AtmosphereData") return UNIFORM_BINDING_ATMOSPHERE;
+    if (blockName == "NoiseLayers") return UNIFORM_BINDING_NOISE_LAYERS;
+    return -1;
+}
+
+UniformBuffer::~UniformBuffer() {
+    Destroy();
+}
+
+void UniformBuffer::Create(UniformBinding binding, GLsizeiptr size) {
+    Destroy();
+    contents.assign(static_cast<size_t>(size), 0);
+    glGenBuffers(1, &buffer);
+    glBindBuffer(GL_UNIFORM_BUFFER, buffer);
+    glBufferData(GL_UNIFORM_BUFFER, size, contents.data(), GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    glBindBufferBase(GL_UNIFORM_BUFFER, binding, buffer);
+}
+
+void UniformBuffer::Destroy() {
+    if (buffer != 0) glDeleteBuffers(1, &buffer);
+    buffer = 0;
+    contents.clear();
+}
+
+bool UniformBuffer::Update(const void* data, GLsizeiptr size, GLintptr offset) {
+    if (offset < 0 || static_cast<size_t>(offset + size) > contents.size()) {
+        std::cerr << "Uniform buffer update of " << size << " bytes at " << offset << " is out of range" << std::endl;
+        return false;
+    }
+    if (std::memcmp(contents.data() + offset, data, static_cast<size_t>(size)) == 0) return false;
+    std::memcpy(contents.data() + offset, data, static_cast<size_t>(size));
+    glBindBuffer(GL_UNIFORM_BUFFER, buffer);
+    glBufferSubData(GL_UNIFORM_BUFFER, offset, size, data);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    uniformUploadStats.blocks++;
+    uniformUploadStats.blockBytes += static_cast<int>(size);
+    return true;
+}
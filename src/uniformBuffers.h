@@ -0,0 +1,100 @@
+#pragma once
+#include <cstdint>
+#include <string_view>
+#include <vector>
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include "noiseLayer.h"
+
+// Binding points of the shared uniform blocks. Every program that declares one of them
+// gets it bound to its point when it's linked, see UniformBlockBinding.
+enum UniformBinding {
+    UNIFORM_BINDING_FRAME = 0,
+    UNIFORM_BINDING_ATMOSPHERE = 1,
+    UNIFORM_BINDING_NOISE_LAYERS = 2,
+};
+
+// Binding point of a block by its name in the shaders, -1 for blocks that aren't shared
+int UniformBlockBinding(std::string_view blockName);
+
+// std140 mirrors of the blocks, keep in sync with frameData.glsl, atmosphereData.glsl and noiseLayers.glsl.
+// bools are 4 bytes in std140, a vec3 followed by a float shares one 16 byte slot.
+
+// Camera and light, changes every frame
+struct FrameUniforms {
+    glm::vec3 cameraPos;
+    float cameraHeight;
+    glm::vec3 lightPos;
+    float cameraHeight2;
+    glm::vec3 lightColor;
+    float aerialPerspectiveNear;
+    float aerialPerspectiveFar;
+    int32_t useSkyViewLut;
+    int32_t useAerialPerspective;
+    float padding;
+};
+static_assert(sizeof(FrameUniforms) == 64, "FrameUniforms must match the std140 layout of FrameData");
+
+// Atmosphere of the planet, changes with the settings
+struct AtmosphereUniforms {
+    glm::vec3 invWavelength4;
+    float atmosphereRadius;
+    float atmosphereRadius2;
+    float planetRadius;
+    float planetRadius2;
+    float kRayleighSunBrightness;
+    float kMieSunBrightness;
+    float scale;
+    float scaleDepth;
+    float densityFalloff;
+    float gMie;
+    float gMie2;
+    float exposure;
+    int32_t nSamples;
+    int32_t opticalDepthMode;
+    int32_t multipleScattering;
+    float padding[2];
+};
+static_assert(sizeof(AtmosphereUniforms) == 80, "AtmosphereUniforms must match the std140 layout of AtmosphereData");
+
+struct NoiseLayerUniforms {
+    int32_t enabled;
+    float strength;
+    float baseRoughness;
+    float roughness;
+    float persistence;
+    int32_t octaves;
+    float visibleOctaves;
+    float minValue;
+    glm::vec3 center;
+    int32_t type;
+    int32_t worleyOutput;
+    float padding[3];
+};
+static_assert(sizeof(NoiseLayerUniforms) == 64, "NoiseLayerUniforms must match the std140 layout of NoiseLayer");
+
+struct NoiseLayersUniforms {
+    int32_t layerCount;
+    int32_t padding[3];
+    NoiseLayerUniforms layers[maxNoiseLayers];
+};
+
+// Buffer backing one uniform block, bound to the block's binding point for as long as it exists
+class UniformBuffer {
+public:
+    UniformBuffer() = default;
+    ~UniformBuffer();
+    UniformBuffer(const UniformBuffer&) = delete;
+    UniformBuffer& operator=(const UniformBuffer&) = delete;
+
+    void Create(UniformBinding binding, GLsizeiptr size);
+    void Destroy();
+    // Uploads the range only if it differs from what the buffer holds, returns whether it did
+    bool Update(const void* data, GLsizeiptr size, GLintptr offset = 0);
+    template <typename T>
+    bool Update(const T& block) { return Update(&block, sizeof(T)); }
+
+private:
+    GLuint buffer = 0;
+    std::vector<unsigned char> contents; // copy of what the buffer holds
+};
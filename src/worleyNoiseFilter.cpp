@@ -0,0 +1,116 @@
+#include "worleyNoiseFilter.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <numeric>
+#include <random>
+
+namespace {
+    // Keeps the two smallest squared distances, without branches (they mispredict constantly here)
+    void Insert(float d2, float& f1, float& f2) {
+        f2 = std::min(f2, std::max(f1, d2));
+        f1 = std::min(f1, d2);
+    }
+}
+
+void WorleyFeatureTable::Build(float seed) {
+    uint32_t seedBits;
+    std::memcpy(&seedBits, &seed, sizeof(seedBits));
+    std::mt19937 rng(seedBits);
+    std::uniform_real_distribution<float> offset(0.0f, 1.0f);
+
+    std::iota(perm.begin(), perm.end(), 0);
+    std::shuffle(perm.begin(), perm.end(), rng);
+    for (glm::vec3& p : points) {
+        p = glm::vec3(offset(rng), offset(rng), offset(rng));
+    }
+}
+
+WorleyNoiseFilter::WorleyNoiseFilter(const NoiseLayer& settings, float seed) : settings(settings) {
+    table.Build(seed);
+}
+
+glm::vec2 WorleyNoiseFilter::Distances(const glm::vec3& point) const {
+    glm::vec3 cell = glm::floor(point);
+    glm::vec3 f = point - cell;
+    int cx = static_cast<int>(cell.x), cy = static_cast<int>(cell.y), cz = static_cast<int>(cell.z);
+
+    float f1 = std::numeric_limits<float>::max();
+    float f2 = std::numeric_limits<float>::max();
+    auto visit = [&](int x, int y, int z) {
+        const glm::vec3& p = table.FeaturePoint(cx + x, cy + y, cz + z);
+        glm::vec3 d = glm::vec3(x, y, z) + p - f;
+        Insert(glm::dot(d, d), f1, f2);
+    };
+
+    // F1 only needs to beat the closest point, the other outputs need both
+    const float& limit = settings.worleyOutput == WorleyOutput::F1 ? f1 : f2;
+
+    // Squared distance to the closer wall of the cell on each axis.
+    // No edge neighbour can be closer than the two smallest combined, no corner closer than all three.
+    glm::vec3 walls = glm::min(f, 1.0f - f);
+    walls *= walls;
+    float edgeBound = std::min(std::min(walls.x + walls.y, walls.x + walls.z), walls.y + walls.z);
+    float cornerBound = walls.x + walls.y + walls.z;
+
+    // Visit the cells in order of how close they can possibly be (same order as worleyOffsets
+    // in worley.glsl), the far groups are skipped once they can't beat the current candidates.
+    // Written out rather than looped so the offsets fold into constants.
+    visit(0, 0, 0);
+    visit(-1, 0, 0); visit(1, 0, 0); visit(0, -1, 0); visit(0, 1, 0); visit(0, 0, -1); visit(0, 0, 1);
+    if (edgeBound < limit) {
+        visit(-1, -1, 0); visit(1, -1, 0); visit(-1, 1, 0); visit(1, 1, 0);
+        visit(-1, 0, -1); visit(1, 0, -1); visit(-1, 0, 1); visit(1, 0, 1);
+        visit(0, -1, -1); visit(0, 1, -1); visit(0, -1, 1); visit(0, 1, 1);
+        if (cornerBound < limit) {
+            visit(-1, -1, -1); visit(1, -1, -1); visit(-1, 1, -1); visit(1, 1, -1);
+            visit(-1, -1, 1); visit(1, -1, 1); visit(-1, 1, 1); visit(1, 1, 1);
+        }
+    }
+    return glm::vec2(std::sqrt(f1), std::sqrt(f2));
+}
+
+glm::vec2 WorleyNoiseFilter::DistancesBruteForce(const glm::vec3& point) const {
+    glm::vec3 cell = glm::floor(point);
+    int cx = static_cast<int>(cell.x), cy = static_cast<int>(cell.y), cz = static_cast<int>(cell.z);
+
+    float f1 = std::numeric_limits<float>::max();
+    float f2 = std::numeric_limits<float>::max();
+    for (int z = -1; z <= 1; z++) {
+        for (int y = -1; y <= 1; y++) {
+            for (int x = -1; x <= 1; x++) {
+                glm::vec3 featurePoint = glm::vec3(cx + x, cy + y, cz + z) + table.FeaturePoint(cx + x, cy + y, cz + z);
+                glm::vec3 d = featurePoint - point;
+                Insert(glm::dot(d, d), f1, f2);
+            }
+        }
+    }
+    return glm::vec2(std::sqrt(f1), std::sqrt(f2));
+}
+
+float WorleyNoiseFilter::Output(const glm::vec2& distances) const {
+    switch (settings.worleyOutput) {
+    case WorleyOutput::F2: return distances.y;
+    case WorleyOutput::F2MinusF1: return distances.y - distances.x;
+    default: return distances.x;
+    }
+}
+
+// Same layering as GenerateWorleyNoise in worley.glsl and EvaluateNoise in planet.vert
+float WorleyNoiseFilter::Evaluate(const glm::vec3& point) const {
+    float noiseValue = 0.0f;
+    float frequency = settings.baseRoughness;
+    float amplitude = 1.0f;
+
+    for (int i = 0; i < settings.octaves; i++) {
+        float v = Output(Distances(point * frequency));
+        noiseValue += (v * 2.0f - 1.0f) * amplitude;
+
+        frequency *= settings.roughness;
+        amplitude *= settings.persistence;
+    }
+
+    noiseValue = noiseValue * settings.strength - settings.minValue;
+    return std::max(0.0f, 0.5f + 0.5f * noiseValue);
+}
@@ -0,0 +1,39 @@
+#pragma once
+#include <array>
+#include <cstdint>
+#include "noiseFilter.h"
+#include "noiseLayer.h"
+
+// Feature points for cellular noise: every integer cell holds one feature point,
+// picked from a small table by hashing the cell coordinates through perm.
+// The same table is uploaded to the GPU (see worley.glsl), so both sides agree.
+struct WorleyFeatureTable {
+    static const int size = 256;
+    std::array<uint8_t, size> perm;
+    std::array<glm::vec3, size> points; // offset of the feature point inside its cell, in [0, 1)
+
+    void Build(float seed);
+    const glm::vec3& FeaturePoint(int x, int y, int z) const {
+        return points[perm[(perm[(perm[x & 255] + y) & 255] + z) & 255]];
+    }
+};
+
+class WorleyNoiseFilter : public NoiseFilter {
+public:
+    WorleyNoiseFilter(const NoiseLayer& settings, float seed);
+    virtual float Evaluate(const glm::vec3& point) const override;
+
+    // Distances to the closest and second closest feature point (F1, F2).
+    // Neighbour cells that can't beat the current candidates are skipped.
+    glm::vec2 Distances(const glm::vec3& point) const;
+    // Reference version scanning all 27 neighbour cells, for validating and benchmarking Distances
+    glm::vec2 DistancesBruteForce(const glm::vec3& point) const;
+
+    const WorleyFeatureTable& GetFeatureTable() const { return table; }
+
+private:
+    float Output(const glm::vec2& distances) const;
+
+    NoiseLayer settings;
+    WorleyFeatureTable table;
+};